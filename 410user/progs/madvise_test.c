@@ -0,0 +1,164 @@
+/* Test program for madvise()
+ * Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ *
+ * Prefaults a new_pages() region with MADV_WILLNEED and checks the
+ * writes that follow take no faults. Gives half of it back with
+ * MADV_DONTNEED and checks that half reads as zero and is usable again
+ * while the other half keeps its data. Does the same to one page and
+ * then all of a 4MB aligned region, which may be backed by a 4MB page.
+ * Bad arguments have to fail.
+ * madvise_test.c
+ */
+
+#include <syscall.h>
+#include <memstats.h>
+#include <madvise.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "410_tests.h"
+
+DEF_TEST_NAME("madvise_test:");
+
+/* 410_tests.h stays as handed out; fail and exit from here */
+#define FAIL(msg, value) \
+  do { REPORT_FAIL_ERR(msg, value); exit(-1); } while (0)
+
+#define ADDR        0x40000000
+#define NR_PAGES    32
+#define LARGE_ADDR  0x40800000
+#define LARGE_SIZE  (4 * 1024 * 1024)
+#define LARGE_PAGES (LARGE_SIZE / PAGE_SIZE)
+
+/** @function  fill
+ *  @brief     writes a tag into the first and last word of each page
+ */
+static void fill(char *base, int first, int nr_pages) {
+  int i;
+
+  for (i = first; i < first + nr_pages; i++) {
+    *(int *)(base + i * PAGE_SIZE) = i + 1;
+    *(int *)(base + (i + 1) * PAGE_SIZE - sizeof(int)) = i + 1;
+  }
+}
+
+/** @function  check
+ *  @brief     returns the first page in the span whose tags are not
+ *             the ones fill() writes, or zero if zero is set; -1 if none
+ */
+static int check(char *base, int first, int nr_pages, int zero) {
+  int i, want;
+
+  for (i = first; i < first + nr_pages; i++) {
+    want = zero ? 0 : i + 1;
+    if (*(int *)(base + i * PAGE_SIZE) != want ||
+        *(int *)(base + (i + 1) * PAGE_SIZE - sizeof(int)) != want)
+      return i;
+  }
+  return -1;
+}
+
+/** @function  zeroed_frames
+ *  @brief     zeroed frames handed out so far; one per first write
+ */
+static int zeroed_frames(void) {
+  memstats_t stats;
+
+  memstats(&stats);
+  return stats.zero_pool_hits + stats.zero_pool_misses;
+}
+
+int main(int argc, char *argv[])
+{
+  char *base = (char *)ADDR;
+  char *large = (char *)LARGE_ADDR;
+  int half = NR_PAGES / 2;
+  memstats_t before, after;
+  int zeroed, bad;
+
+  REPORT_START_CMPLT;
+
+  if (new_pages(base, NR_PAGES * PAGE_SIZE) != 0)
+    FAIL("new_pages failed: ", NR_PAGES);
+
+  //-- WILLNEED backs every page; the writes after it take no faults --//
+  memstats(&before);
+  if (madvise(base, NR_PAGES * PAGE_SIZE, MADV_WILLNEED) != 0)
+    FAIL("MADV_WILLNEED failed: ", NR_PAGES);
+  memstats(&after);
+  if (after.madvise_prefaulted - before.madvise_prefaulted != NR_PAGES)
+    FAIL("pages prefaulted: ",
+         after.madvise_prefaulted - before.madvise_prefaulted);
+
+  zeroed = zeroed_frames();
+  fill(base, 0, NR_PAGES);
+  if (zeroed_frames() != zeroed)
+    FAIL("writes after MADV_WILLNEED faulted: ", zeroed_frames() - zeroed);
+
+  //-- DONTNEED on the top half; the range stays --//
+  memstats(&before);
+  if (madvise(base + half * PAGE_SIZE, half * PAGE_SIZE, MADV_DONTNEED) != 0)
+    FAIL("MADV_DONTNEED failed: ", half);
+  memstats(&after);
+  if (after.madvise_dropped - before.madvise_dropped != half)
+    FAIL("pages dropped: ", after.madvise_dropped - before.madvise_dropped);
+
+  if ((bad = check(base, 0, half, 0)) >= 0)
+    FAIL("kept page lost its data: ", bad);
+  if ((bad = check(base, half, half, 1)) >= 0)
+    FAIL("dropped page did not read zero: ", bad);
+
+  fill(base, half, half);
+  if ((bad = check(base, 0, NR_PAGES, 0)) >= 0)
+    FAIL("page wrong after refill: ", bad);
+
+  //-- fault-around advice --//
+  if (madvise(base, NR_PAGES * PAGE_SIZE, MADV_SEQUENTIAL) != 0 ||
+      madvise(base, NR_PAGES * PAGE_SIZE, MADV_RANDOM) != 0 ||
+      madvise(base, NR_PAGES * PAGE_SIZE, MADV_NORMAL) != 0)
+    FAIL("fault-around advice failed: ", 0);
+
+  //-- bad arguments --//
+  if (madvise(base + 1, PAGE_SIZE, MADV_DONTNEED) >= 0)
+    FAIL("unaligned address accepted: ", 0);
+  if (madvise(base, 0, MADV_DONTNEED) >= 0)
+    FAIL("empty length accepted: ", 0);
+  if (madvise(base, PAGE_SIZE, 99) >= 0)
+    FAIL("unknown advice accepted: ", 99);
+  if (madvise(base, (NR_PAGES + 1) * PAGE_SIZE, MADV_DONTNEED) >= 0)
+    FAIL("span past the range accepted: ", NR_PAGES + 1);
+  if (madvise(base + NR_PAGES * PAGE_SIZE, PAGE_SIZE, MADV_WILLNEED) >= 0)
+    FAIL("address outside any range accepted: ", 0);
+  if ((bad = check(base, 0, NR_PAGES, 0)) >= 0)
+    FAIL("failed advice touched page: ", bad);
+
+  if (remove_pages(base) != 0)
+    FAIL("remove_pages failed: ", 0);
+
+  //-- 4MB region: one page out of the middle, then all of it --//
+  if (new_pages(large, LARGE_SIZE) != 0)
+    FAIL("new_pages failed: ", LARGE_PAGES);
+  fill(large, 0, LARGE_PAGES);
+
+  if (madvise(large + half * PAGE_SIZE, PAGE_SIZE, MADV_DONTNEED) != 0)
+    FAIL("MADV_DONTNEED of one page failed: ", half);
+  if ((bad = check(large, 0, half, 0)) >= 0 ||
+      (bad = check(large, half + 1, LARGE_PAGES - half - 1, 0)) >= 0)
+    FAIL("neighbour of dropped page lost its data: ", bad);
+  if ((bad = check(large, half, 1, 1)) >= 0)
+    FAIL("dropped page did not read zero: ", bad);
+
+  if (madvise(large, LARGE_SIZE, MADV_DONTNEED) != 0)
+    FAIL("MADV_DONTNEED of 4MB failed: ", LARGE_PAGES);
+  if ((bad = check(large, 0, LARGE_PAGES, 1)) >= 0)
+    FAIL("dropped page did not read zero: ", bad);
+
+  fill(large, 0, LARGE_PAGES);
+  if ((bad = check(large, 0, LARGE_PAGES, 0)) >= 0)
+    FAIL("page wrong after refill: ", bad);
+
+  if (remove_pages(large) != 0)
+    FAIL("remove_pages failed: ", 1);
+
+  REPORT_END_SUCCESS;
+  exit(0);
+}
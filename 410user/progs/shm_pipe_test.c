@@ -0,0 +1,154 @@
+/* Test program and benchmark for shared memory segments
+ * Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ *
+ * A producer and a forked consumer pipeline messages through a ring
+ * buffer in one segment, without any copy by the kernel. The consumer
+ * checks every word of every message and leaves its count in the
+ * segment, where the parent has to find it: writes to a segment after
+ * fork are never copied on write. Reports the ticks the transfer took.
+ * Also checks that a segment attached twice aliases the same frames,
+ * that remove_pages() leaves segments alone, that bad ids and addresses
+ * are refused, and that the segment goes away with its last attachment.
+ * shm_pipe_test.c
+ */
+
+#include <syscall.h>
+#include <memstats.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "410_tests.h"
+
+DEF_TEST_NAME("shm_pipe_test:");
+
+/* 410_tests.h stays as handed out; fail and exit from here */
+#define FAIL(msg, value) \
+  do { REPORT_FAIL_ERR(msg, value); exit(-1); } while (0)
+
+#define RING_ADDR   0x40000000
+#define ALIAS_ADDR  0x48000000
+#define SLOT_WORDS  (PAGE_SIZE / sizeof(unsigned int))
+#define NR_SLOTS    8
+#define NR_MSGS     256
+#define SEG_BYTES   ((NR_SLOTS + 1) * PAGE_SIZE)
+
+//-- first page of the segment; the slots follow it --//
+typedef struct ring {
+  volatile int head;            //- messages produced -//
+  volatile int tail;            //- messages consumed -//
+  volatile int checked;         //- messages the consumer found intact -//
+} ring_t;
+
+#define RING       ((ring_t *)RING_ADDR)
+#define SLOT(n)    ((volatile unsigned int *)(RING_ADDR + \
+                     ((n) % NR_SLOTS + 1) * PAGE_SIZE))
+#define WORD(m, w) ((unsigned int)(m) * 0x9e3779b9u + (w))
+
+/** @function  consume
+ *  @brief     takes every message off the ring and checks it
+ */
+static void consume(void) {
+  volatile unsigned int *slot;
+  int m, w, ok;
+
+  for (m = 0; m < NR_MSGS; m++) {
+    while (RING->head == m)
+      yield(-1);
+
+    slot = SLOT(m);
+    ok = 1;
+    for (w = 0; w < SLOT_WORDS; w++)
+      if (slot[w] != WORD(m, w))
+        ok = 0;
+    RING->checked += ok;
+    RING->tail = m + 1;
+  }
+  exit(0);
+}
+
+/** @function  produce
+ *  @brief     puts every message on the ring
+ */
+static void produce(int consumer) {
+  volatile unsigned int *slot;
+  int m, w;
+
+  for (m = 0; m < NR_MSGS; m++) {
+    while (m - RING->tail == NR_SLOTS)
+      yield(consumer);
+
+    slot = SLOT(m);
+    for (w = 0; w < SLOT_WORDS; w++)
+      slot[w] = WORD(m, w);
+    RING->head = m + 1;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  memstats_t stats;
+  int id, pid, status, segments, ticks;
+
+  REPORT_START_CMPLT;
+
+  memstats(&stats);
+  segments = stats.shm_segments;
+
+  //-- bad arguments are refused --//
+  if (shm_create((void *)(RING_ADDR + 1), SEG_BYTES) >= 0)
+    FAIL("unaligned shm_create accepted: ", 0);
+  if (shm_create((void *)RING_ADDR, 0) >= 0)
+    FAIL("empty shm_create accepted: ", 0);
+  if (shm_attach(-1, (void *)RING_ADDR) >= 0)
+    FAIL("shm_attach of a bad id accepted: ", 0);
+  if (shm_detach((void *)RING_ADDR) >= 0)
+    FAIL("shm_detach of nothing accepted: ", 0);
+
+  id = shm_create((void *)RING_ADDR, SEG_BYTES);
+  if (id <= 0)
+    FAIL("shm_create failed: ", id);
+  if (shm_attach(id, (void *)(RING_ADDR + PAGE_SIZE)) >= 0)
+    FAIL("overlapping shm_attach accepted: ", id);
+  if (remove_pages((void *)RING_ADDR) >= 0)
+    FAIL("remove_pages of a segment accepted: ", id);
+
+  //-- a second attachment maps the same frames --//
+  if (shm_attach(id, (void *)ALIAS_ADDR) != 0)
+    FAIL("shm_attach failed: ", id);
+  ((ring_t *)ALIAS_ADDR)->checked = 0x410;
+  if (RING->checked != 0x410)
+    FAIL("attachments do not alias: ", RING->checked);
+  if (shm_detach((void *)ALIAS_ADDR) != 0)
+    FAIL("shm_detach failed: ", 0);
+  RING->checked = 0;
+
+  //-- pipeline through the ring; the child inherits it --//
+  ticks = get_ticks();
+  pid = fork();
+  if (pid < 0)
+    FAIL("fork failed: ", pid);
+  if (pid == 0)
+    consume();
+
+  produce(pid);
+  if (wait(&status) != pid || status != 0)
+    FAIL("consumer failed: ", status);
+  ticks = get_ticks() - ticks;
+
+  if (RING->checked != NR_MSGS)
+    FAIL("messages intact in the parent's view: ", RING->checked);
+
+  lprintf("%s%s %d messages of %d bytes in %d ticks", TEST_PFX, test_name,
+          NR_MSGS, PAGE_SIZE, ticks);
+
+  //-- the last attachment takes the segment with it --//
+  if (shm_detach((void *)RING_ADDR) != 0)
+    FAIL("shm_detach failed: ", 0);
+  if (shm_attach(id, (void *)RING_ADDR) >= 0)
+    FAIL("segment outlived its attachments: ", id);
+  memstats(&stats);
+  if (stats.shm_segments != segments)
+    FAIL("segments left behind: ", stats.shm_segments - segments);
+
+  REPORT_END_SUCCESS;
+  exit(0);
+}
@@ -0,0 +1,138 @@
+/** @file     spawn_test.c
+ *  @brief    Test for the spawn() system call
+ *
+ *            Spawns copies of itself with arguments and checks that the
+ *            children see their argv, initialized data and zeroed bss,
+ *            and that their exit status comes back through wait().
+ *            Spawning never write protects the parent, so the parent's
+ *            next writes must not take copy on write faults. Spawning a
+ *            program that does not exist must fail without a child.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <syscall.h>
+#include <memstats.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "410_tests.h"
+
+DEF_TEST_NAME("spawn_test:");
+
+#ifndef PAGE_SIZE
+#define PAGE_SIZE 4096
+#endif
+
+#define NR_CHILDREN   8
+#define CHILD_STATUS  17
+#define DATA_MAGIC    0x410
+
+//-- the children check these come up the way the image says --//
+int data_val = DATA_MAGIC;
+int bss_val[PAGE_SIZE / sizeof(int)];
+
+//-- written by the parent around the spawns --//
+char parent_pages[4 * PAGE_SIZE];
+
+/** @function  child_main
+ *  @brief     runs in the spawned copies
+ */
+static int child_main(int argc, char *argv[]) {
+  unsigned int i;
+
+  if (argc != 3 || strcmp(argv[1], "child") != 0)
+    return -2;
+  if (data_val != DATA_MAGIC)
+    return -3;
+  for (i = 0; i < sizeof(bss_val) / sizeof(int); i++)
+    if (bss_val[i] != 0)
+      return -4;
+  return atoi(argv[2]);
+}
+
+/** @function  touch_parent_pages
+ *  @brief     writes every page of parent_pages
+ */
+static void touch_parent_pages(char value) {
+  unsigned int p;
+
+  for (p = 0; p < sizeof(parent_pages); p += PAGE_SIZE)
+    parent_pages[p] = value;
+}
+
+int main(int argc, char *argv[])
+{
+  char *name = "spawn_test";
+  char *args[] = {name, "child", "17", 0};
+  char *bad_args[] = {"no_such_program", 0};
+  memstats_t before, after;
+  int pid[NR_CHILDREN];
+  int i, j, reaped, status;
+
+  if (argc > 1)
+    exit(child_main(argc, argv));
+
+  REPORT_START_CMPLT;
+
+  //-- make the parent's pages private before the snapshot --//
+  touch_parent_pages(1);
+  if (memstats(&before) != 0) {
+    REPORT_MISC("memstats failed");
+    REPORT_END_FAIL;
+    exit(-1);
+  }
+
+  for (i = 0; i < NR_CHILDREN; i++) {
+    pid[i] = spawn(name, args);
+    if (pid[i] < 0) {
+      REPORT_ERR("spawn failed: ", pid[i]);
+      REPORT_END_FAIL;
+      exit(-1);
+    }
+  }
+
+  //-- nothing was shared with the children; no copies on write --//
+  touch_parent_pages(2);
+  memstats(&after);
+  if (after.cow_copies != before.cow_copies ||
+      after.cow_promotions != before.cow_promotions) {
+    REPORT_ERR("parent took copy on write faults: ",
+               after.cow_copies - before.cow_copies);
+    REPORT_END_FAIL;
+    exit(-1);
+  }
+
+  for (reaped = 0; reaped < NR_CHILDREN; reaped++) {
+    i = wait(&status);
+    for (j = 0; j < NR_CHILDREN; j++)
+      if (pid[j] == i)
+        break;
+    if (j == NR_CHILDREN) {
+      REPORT_ERR("wait returned a stranger: ", i);
+      REPORT_END_FAIL;
+      exit(-1);
+    }
+    if (status != CHILD_STATUS) {
+      REPORT_ERR("child exit status: ", status);
+      REPORT_END_FAIL;
+      exit(-1);
+    }
+    pid[j] = -1;
+  }
+
+  //-- a failed spawn leaves no child behind --//
+  if (spawn(bad_args[0], bad_args) >= 0) {
+    REPORT_MISC("spawn of a missing program succeeded");
+    REPORT_END_FAIL;
+    exit(-1);
+  }
+  if (wait(&status) >= 0) {
+    REPORT_MISC("failed spawn left a child");
+    REPORT_END_FAIL;
+    exit(-1);
+  }
+
+  REPORT_END_SUCCESS;
+  exit(0);
+}
@@ -0,0 +1,64 @@
+/* Test program for stack growth by more than one page per fault
+ * Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ *
+ * Recurses through frames of several pages each, writing the lowest
+ * byte of every frame first so each call faults pages below the stack
+ * rather than right under it. Every frame has to keep its bytes until
+ * the recursion unwinds.
+ * stack_grow_test.c
+ */
+
+#include <syscall.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "410_tests.h"
+
+DEF_TEST_NAME("stack_grow_test:");
+
+/* 410_tests.h stays as handed out; fail and exit from here */
+#define FAIL(msg, value) \
+  do { REPORT_FAIL_ERR(msg, value); exit(-1); } while (0)
+
+#define FRAME_PAGES 5
+#define FRAME_BYTES (FRAME_PAGES * PAGE_SIZE)
+#define DEPTH       64
+
+/** @function  descend
+ *  @brief     recurses depth times through frames of FRAME_PAGES pages
+ *  @return    number of frames that kept their bytes
+ */
+static int descend(int depth) {
+  volatile char frame[FRAME_BYTES];
+  int i, kept;
+
+  //-- lowest address first; pages above it are not touched yet --//
+  frame[0] = (char)depth;
+  for (i = PAGE_SIZE; i < FRAME_BYTES; i += PAGE_SIZE)
+    frame[i] = (char)(depth + i / PAGE_SIZE);
+
+  kept = depth ? descend(depth - 1) : 0;
+
+  for (i = PAGE_SIZE; i < FRAME_BYTES; i += PAGE_SIZE)
+    if (frame[i] != (char)(depth + i / PAGE_SIZE))
+      return kept;
+  return frame[0] == (char)depth ? kept + 1 : kept;
+}
+
+int main(int argc, char *argv[])
+{
+  int kept;
+
+  REPORT_START_CMPLT;
+
+  kept = descend(DEPTH);
+  if (kept != DEPTH + 1)
+    FAIL("frames that lost their bytes: ", DEPTH + 1 - kept);
+
+  //-- a second pass runs on the grown stack --//
+  kept = descend(DEPTH);
+  if (kept != DEPTH + 1)
+    FAIL("frames lost on the grown stack: ", DEPTH + 1 - kept);
+
+  REPORT_END_SUCCESS;
+  exit(0);
+}
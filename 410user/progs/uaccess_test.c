@@ -0,0 +1,86 @@
+/* Test program for system calls reading and writing user memory
+ * Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ *
+ * Bad pointers handed to print(), get_cursor_pos() and exec() have to
+ * fail the call, not kill the caller. Good pointers into pages never
+ * touched before have to work. A position written by the kernel into a
+ * page a child shares with its parent after fork must not show up in
+ * the parent.
+ * uaccess_test.c
+ */
+
+#include <syscall.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "410_tests.h"
+
+DEF_TEST_NAME("uaccess_test:");
+
+/* 410_tests.h stays as handed out; fail and exit from here */
+#define FAIL(msg, value) \
+  do { REPORT_FAIL_ERR(msg, value); exit(-1); } while (0)
+
+#define ADDR        0x40000000
+#define NR_PAGES    4
+#define UNMAPPED    ((char *)0x50000000)
+#define KERNEL_ADDR ((char *)0x00100000)
+
+int main(int argc, char *argv[])
+{
+  char *base = (char *)ADDR;
+  char *args[2];
+  int row, col, shared, pid, status;
+
+  REPORT_START_CMPLT;
+
+  //-- bad buffers fail the call --//
+  if (print(4, KERNEL_ADDR) >= 0)
+    FAIL("print of kernel memory accepted: ", 0);
+  if (print(4, UNMAPPED) >= 0)
+    FAIL("print of unmapped memory accepted: ", 0);
+  if (get_cursor_pos((int *)KERNEL_ADDR, &col) >= 0)
+    FAIL("get_cursor_pos into kernel memory accepted: ", 0);
+  if (get_cursor_pos(&row, (int *)UNMAPPED) >= 0)
+    FAIL("get_cursor_pos into unmapped memory accepted: ", 0);
+
+  args[0] = "uaccess_test";
+  args[1] = NULL;
+  if (exec(UNMAPPED, args) >= 0)
+    FAIL("exec of an unmapped filename accepted: ", 0);
+  if (exec("uaccess_test", (char **)UNMAPPED) >= 0)
+    FAIL("exec of an unmapped argv accepted: ", 0);
+
+  //-- untouched pages are backed by the copy --//
+  if (new_pages(base, NR_PAGES * PAGE_SIZE) != 0)
+    FAIL("new_pages failed: ", NR_PAGES);
+  if (get_cursor_pos(&row, &col) != 0)
+    FAIL("get_cursor_pos failed: ", 0);
+  if (get_cursor_pos((int *)(base + PAGE_SIZE), (int *)(base + 3 * PAGE_SIZE)) != 0)
+    FAIL("get_cursor_pos into untouched pages failed: ", 0);
+  if (*(int *)(base + PAGE_SIZE) != row || *(int *)(base + 3 * PAGE_SIZE) != col)
+    FAIL("get_cursor_pos wrote the wrong row: ", *(int *)(base + PAGE_SIZE));
+  if (print(1, base + 2 * PAGE_SIZE) < 0)
+    FAIL("print of an untouched page failed: ", 0);
+
+  //-- a kernel write breaks copy on write like a user write --//
+  shared = -1;
+  pid = fork();
+  if (pid < 0)
+    FAIL("fork failed: ", pid);
+  if (pid == 0) {
+    if (get_cursor_pos(&shared, &col) != 0)
+      exit(1);
+    exit(shared == row ? 0 : 2);
+  }
+  if (wait(&status) != pid || status != 0)
+    FAIL("child could not write its copy: ", status);
+  if (shared != -1)
+    FAIL("child's write showed up in the parent: ", shared);
+
+  if (remove_pages(base) != 0)
+    FAIL("remove_pages failed: ", 0);
+
+  REPORT_END_SUCCESS;
+  exit(0);
+}
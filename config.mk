@@ -100,7 +100,13 @@ STUDENTREQPROGS =
 	cho \
 	cho2 \
 	mandelbrot \
-	racer
+	racer \
+	buddy_stress \
+	spawn_test \
+	madvise_test \
+	stack_grow_test \
+	uaccess_test \
+	shm_pipe_test
 
 
 #exec_basic_helper getpid_test1 peon merchant fork_test1 halt_test \
@@ -161,6 +167,14 @@ SYSCALL_OBJS = sc_lc_fork.o   \
 	sc_con_get_cursor_pos.o \
 	sc_misc_halt.o		\
 	sc_misc_ls.o		\
+	sc_misc_memstats.o	\
+	sc_lc_spawn.o		\
+	sc_misc_frame_mappings.o \
+	sc_misc_wss_stats.o	\
+	sc_mm_madvise.o		\
+	sc_mm_shm_create.o	\
+	sc_mm_shm_attach.o	\
+	sc_mm_shm_detach.o	\
 	sc_spc_misbehave.o
 
 
@@ -185,6 +199,7 @@ KERNEL_OBJS = kernel.o 				\
 	$(BOOT_DRVLIB_DIR)/keyb_driver.o	\
         $(I386_UTIL_DIR)/i386systemregs.o	\
 	$(I386_UTIL_DIR)/i386isrwrapper.o	\
+	$(I386_UTIL_DIR)/i386uaccess.o		\
 	$(SYSCALL_DIR)/syscall.o		\
 	$(SYSCALL_DIR)/syscallWrapper.o		\
 	$(SYSCALL_DIR)/syscall_exec.o		\
@@ -204,8 +219,29 @@ KERNEL_OBJS = kernel.o 				\
 	$(SYSCALL_DIR)/syscall_pages.o		\
 	$(SYSCALL_DIR)/syscall_cas2irunflag.o	\
 	$(SYSCALL_DIR)/syscall_paramcheck.o	\
+	$(SYSCALL_DIR)/syscall_memstats.o	\
+	$(SYSCALL_DIR)/syscall_spawn.o	\
+	$(SYSCALL_DIR)/syscall_frame_mappings.o	\
+	$(SYSCALL_DIR)/syscall_wss_stats.o	\
+	$(SYSCALL_DIR)/syscall_madvise.o	\
+	$(SYSCALL_DIR)/syscall_shm.o	\
 	$(FAULT_DIR)/faulthandlers.o            \
 	$(VMM_DIR)/vmm.o			\
+	$(VMM_DIR)/vmm_buddy.o			\
+	$(VMM_DIR)/vmm_range_tree.o		\
+	$(VMM_DIR)/vmm_fault.o			\
+	$(VMM_DIR)/vmm_zeropool.o		\
+	$(VMM_DIR)/vmm_tlb.o			\
+	$(VMM_DIR)/vmm_image.o			\
+	$(VMM_DIR)/vmm_exec.o			\
+	$(VMM_DIR)/vmm_rmap.o			\
+	$(VMM_DIR)/vmm_swap.o			\
+	$(VMM_DIR)/vmm_wss.o			\
+	$(VMM_DIR)/vmm_ksm.o			\
+	$(VMM_DIR)/vmm_cache.o			\
+	$(VMM_DIR)/vmm_kstack.o			\
+	$(VMM_DIR)/vmm_uaccess.o		\
+	$(VMM_DIR)/vmm_shm.o			\
 	$(TASK_DIR)/task.o			\
 	$(TASK_DIR)/initTaskCode.o		\
 	$(SCHED_DIR)/sched.o			\
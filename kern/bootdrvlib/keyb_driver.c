@@ -21,7 +21,7 @@
 #include "keyb_driver.h"
 #include "bootdrvlib/console_driver.h"
 
-#define  CAT_KEYB_KEYS_NUM 110
+#define  CAT_KEYB_KEYS_NUM KEYB_DRIVER_LINE_MAX
 #define  READ_LINE_CHARACTER 10
 
 /** @typedef  KEYB_DRIVER_STATE
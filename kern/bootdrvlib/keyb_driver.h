@@ -21,6 +21,11 @@
 #define KEYB_DRIVER_IDT_IDX         (KEY_IDT_ENTRY)
 #define KEYB_DRIVER_MASTER_ACK_IDX  (KEY_ID_ENTRY - ADDR_PIC_BASE) 
 
+/** @constant KEYB_DRIVER_LINE_MAX
+ *  @brief size of the key buffer; no line read is longer
+ */
+#define KEYB_DRIVER_LINE_MAX        110
+
 //------------------------------------------------------------------------------
 // Game exports see definitions for documentation
 //------------------------------------------------------------------------------
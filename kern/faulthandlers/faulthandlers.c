@@ -27,11 +27,6 @@
 #include <task.h>
 
 #define MAX_FAULT_HANDLERS     20
-#define PAGE_FAULT_REASON_IDX  -6
-
-#define SRC_PAGE_MAP_IDX       0
-#define DST_PAGE_MAP_IDX       1
-char    *copy_area;
 
 
 #define FAULT_ACTION_KILL         0
@@ -61,7 +56,7 @@ void  static alignment_fault_handler();
 void  static opcode_fault_handler();
 void  static device_fault_handler();
 void  static double_fault_handler();
-void  static page_fault_handler();
+void         page_fault_handler(i386_fault_frame *frame);
 
 
 
@@ -99,33 +94,6 @@ HANDLE_FAULT faulthandler_table[TOTAL_FAULT_HANDLERS] =
 
 
 
-    
-/** @function  invalidate_tlb
- *  @brief     This function invalidates the tlb using the asm INVLPG instruction
- *  @param     addr - faulting address requiring action
- *  @return    void
- */
-
-static inline void invalidate_tlb(unsigned long addr)
-{
-        asm volatile("invlpg (%0)" ::"r" (addr) : "memory");
-}
-    
-/** @function  relocate_iret_frame
- *  @brief     This function relocates the iret frame setup on top of kernel stack
- *             so as to be appropriately handled by suitable faulthandler
- *  @param     none
- *  @return    void
- */
-
-static inline void relocate_iret_frame() {
-  kthread *thisThread = CURRENT_THREAD;
-  int i;
-  for(i=PAGE_FAULT_REASON_IDX; i <= -1;i++)
-    thisThread->context.kstack[i] = thisThread->context.kstack[i+1];
-}
-
-
 /*
   Following cases                              Action     
   1. Write on COW Pages                        Allocate new page & copy 
@@ -134,7 +102,7 @@ static inline void relocate_iret_frame() {
   3. Trying to access kernel memory            Kill
   4. Trying to access un-mapped random memory  Kill
   5. Write on RO section.                      Kill
-  6. Fault in Kernel mode                      Panic.
+  6. Fault in a user memory copy               Resume at its fixup
 */
 
 /** @function  analyse_fault
@@ -173,8 +141,8 @@ int static analyse_fault(PTE reason,
 
 
   //- We will not get the VMRange in case stack is growing -//
-  if(NULL == vm_range_ptr && (unsigned long)linear_address ==  
-     CURRENT_THREAD->pTask->vm.vm_stack_start - 1) {
+  if(NULL == vm_range_ptr &&
+     vmm_get_growable_range(&CURRENT_THREAD->pTask->vm,linear_address)) {
     return FAULT_ACTION_GROW_STACK;
   }
 
@@ -185,145 +153,46 @@ int static analyse_fault(PTE reason,
 /** @function  _BASE_FAULT_HANDLER
  *  @brief     This function sets up the handler actions
  *             and appropriately executes a suitable handler for the analyzed fault
- *  @param     none
+ *  @param     frame - registers, error code and iret frame saved by pf_wrapper
  *  @return    void
  */
 
-void static page_fault_handler(void) {
+void page_fault_handler(i386_fault_frame *frame) {
   KERN_RET_CODE  ret;
-  vm_range *vmrange_ptr;
   kthread *thisThread = CURRENT_THREAD;
-  PTE      reason,attr;
-  PTE     *faulting_pte;
-  PTE     *faulting_pde;
+  PTE      reason;
   uint32_t linear_address;
-  PTE     *src_dst_pte;
-  PFN      newPageFrame;
+  unsigned long fixup;
   ktask   *task;
-  PTE     *new_pte=NULL;
-  LINEAR_ADDRESS_BREAKER linear_address_b;
   char errmsg[200];
 
 
 
   //- collect all information --//
-  reason = *(PTE *)(thisThread->context.kstack+PAGE_FAULT_REASON_IDX);
-  relocate_iret_frame();
+  reason = *(PTE *)&frame->error_code;
   linear_address = (uint32_t) get_cr2();
-  faulting_pte = vmm_get_pte(&thisThread->pTask->vm,linear_address);
-  faulting_pde = vmm_get_pde(&thisThread->pTask->vm,linear_address);
-  src_dst_pte  = vmm_get_pte(&thisThread->pTask->vm,(uint32_t)copy_area);
 
   //DUMP("IN PAGE FAULTHANDLERS for thread %p stack %p %p",
   //     thisThread,thisThread->context.kstack,(char *)linear_address);
 
-  //- setup copy regions      --//
-  src_dst_pte[SRC_PAGE_MAP_IDX].PRESENT = 1;
-  src_dst_pte[SRC_PAGE_MAP_IDX].RW      = 1;
-  src_dst_pte[SRC_PAGE_MAP_IDX].US      = 0;
-  src_dst_pte[SRC_PAGE_MAP_IDX].WT      = 1;
-  src_dst_pte[SRC_PAGE_MAP_IDX].ADDRESS = 0;
-
-  src_dst_pte[DST_PAGE_MAP_IDX].PRESENT = 1;
-  src_dst_pte[DST_PAGE_MAP_IDX].RW      = 1;
-  src_dst_pte[DST_PAGE_MAP_IDX].US      = 0;
-  src_dst_pte[DST_PAGE_MAP_IDX].WT      = 1;
-  src_dst_pte[DST_PAGE_MAP_IDX].ADDRESS = 0;
-
-
   switch(analyse_fault(reason,linear_address)) {
   case FAULT_ACTION_GROW_STACK: 
-    //- simple action for now - just extends the stack range by 1 page downward -//
-
-    linear_address_b.address = (unsigned long)linear_address;
-
-    //-- Install the PTE entryin PDE if its not already --//
-    if(!CURRENT_THREAD->pTask->vm.pde_base[linear_address_b.u.PDE_IDX].PRESENT) {
-        new_pte = smemalign( PAGE_SIZE , PAGE_SIZE );
-	if(!new_pte) {
-	  ret = KERN_NO_MEM;
-	  DUMP("Cannot grow stack low on memory");
-	  goto action_kill;
-	}
-	memset( new_pte , 0 , PAGE_SIZE );
-
-	//-- set up the entry in PDE --//
-	//-- this function sets up the tables and does not cares about
-	//-- protection bits caller must set it up using VMM_get_pte
-	CURRENT_THREAD->pTask->vm.pde_base[linear_address_b.u.PDE_IDX].PRESENT = 1;
-	CURRENT_THREAD->pTask->vm.pde_base[linear_address_b.u.PDE_IDX].ADDRESS =
-	  (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
-    }
-
-
-    //- adjust the kstack vmm_range -//
-    vmrange_ptr = vmm_get_range(&thisThread->pTask->vm,
-				(char *)thisThread->pTask->vm.vm_stack_start);
-    assert(NULL != vmrange_ptr);
-    if(NULL == vmrange_ptr)
-      goto action_kill;
-
-    vmrange_ptr->start -= PAGE_SIZE;
-    thisThread->pTask->vm.vm_stack_start -= PAGE_SIZE;
-
-    //- set up the stack range attributes again --//
-    memset(&attr,0,sizeof(attr));
-    attr.PRESENT      = 1;
-    attr.RW           = 1;
-    attr.US           = 1;
-    attr.GLOBAL       = 0;
-    vmm_set_range_attr( &thisThread->pTask->vm , vmrange_ptr , attr );
-
-
-    faulting_pte = vmm_get_pte(&thisThread->pTask->vm,linear_address);
-    faulting_pde = vmm_get_pde(&thisThread->pTask->vm,linear_address);
-    invalidate_tlb(linear_address);
-
-    //- fall through to back the page -//
-  case FAULT_ACTION_BACK_PAGES:
-    ret = vmm_get_free_user_pages(&newPageFrame); 
+    //- extend the stack range down over the address, several pages at once -//
+    ret = vmm_grow_range(&thisThread->pTask->vm,linear_address);
     if( KERN_SUCCESS != ret ){
-      DUMP("No free pages to perform backing");
+      DUMP("Cannot grow stack to %p err %d",(char *)linear_address,ret);
       goto action_kill;
     }
-    faulting_pte->PRESENT = 1;
-    faulting_pte->ADDRESS = newPageFrame;
-    faulting_pte->RW      = 1;
-    invalidate_tlb(linear_address);
-    //- Zero out the page -//
-    memset((char *)((unsigned long)linear_address & ~PAGE_MASK),
-	   0,
-	   PAGE_SIZE);
-    return;
-    break; 
 
+    //- fall through to back the page -//
+  case FAULT_ACTION_BACK_PAGES:
   case FAULT_ACTION_COW:
-    //- map in src actual page              -//
-    src_dst_pte[SRC_PAGE_MAP_IDX].ADDRESS = faulting_pte->ADDRESS;
-    
-    //- allocate and map in new page        -//
-    ret = vmm_get_free_user_pages(&newPageFrame); 
+    //- zero page on read; private frame on write -//
+    ret = vmm_fault_in(&thisThread->pTask->vm,linear_address,reason.RW);
     if( KERN_SUCCESS != ret ){
-      DUMP("No free pages to perform copy on write");
+      DUMP("Cannot resolve fault at %p err %d",(char *)linear_address,ret);
       goto action_kill;
     }
-    src_dst_pte[DST_PAGE_MAP_IDX].ADDRESS = newPageFrame;
-
-    //- copy                                   -//
-    invalidate_tlb((unsigned long)copy_area);
-    invalidate_tlb((unsigned long)copy_area+PAGE_SIZE);
-    
-    memcpy(copy_area+PAGE_SIZE,copy_area,PAGE_SIZE);
-
-    faulting_pte->ADDRESS = newPageFrame;
-    if(vmm_is_address_ro(&CURRENT_THREAD->pTask->vm,(void *)linear_address)) {
-
-      faulting_pte->RW = 0;
-      faulting_pde->RW = 0;
-    }else {
-      faulting_pte->RW = 1;
-      faulting_pde->RW = 1;
-    }
     break;
 
   case FAULT_ACTION_PANIC:
@@ -332,6 +201,15 @@ void static page_fault_handler(void) {
 
   case FAULT_ACTION_KILL:
     action_kill:
+    //- a user memory copy that faulted fails instead -//
+    if( !(frame->cs & i386_PL3) ) {
+      fixup = i386_ex_fixup(frame->eip);
+      if( fixup ) {
+	frame->eip = fixup;
+	return;
+      }
+    }
+
     task = (CURRENT_THREAD)->pTask;
     DUMP("killing thread %p faulted at address %p",CURRENT_THREAD , (char *)linear_address);
     (CURRENT_THREAD)->run_flag = -1;
@@ -340,6 +218,7 @@ void static page_fault_handler(void) {
     //  vmm_free_task_vm( task);
     
     Q_REMOVE( &task->ktask_threads_head , (CURRENT_THREAD) , kthread_next );
+    thread_unregister( CURRENT_THREAD );
     if(task->ktask_threads_head.nr_elements == 0) {
       task->state = TASK_STATUS_ZOMIE;
       //- we cannot be scheduled anymore now -//
@@ -351,11 +230,16 @@ void static page_fault_handler(void) {
       sem_signal(&task->parentTask->vultures);
     }
 
+    // -- a forked thread's stack is freed once we are off it -- //
+    disable_preemption();
+    if( &task->initial_thread != CURRENT_THREAD )
+      vmm_kstack_free_self();
+
     schedule(CURRENT_NOT_RUNNABLE); // -- yield to next runnable thread -- //
     break;
   }
 
-  invalidate_tlb(linear_address);
+  //- vmm_fault_in already invalidated what it changed -//
   return;
 
 }
@@ -382,6 +266,7 @@ void static fault_generic_fatal() {
 
   // -- remove the current faulted thread from the task queue -- //
   Q_REMOVE( &task->ktask_threads_head , (CURRENT_THREAD) , kthread_next );
+  thread_unregister( CURRENT_THREAD );
 
   // -- if current thread is initial thread -- //
   if( &task->initial_thread == CURRENT_THREAD ) {
@@ -390,9 +275,10 @@ void static fault_generic_fatal() {
     Q_FOREACH( thread , &task->ktask_threads_head , kthread_next ) {
       // -- dequeue the thread from the task thread queue -- // 
       Q_REMOVE( &task->ktask_threads_head , thread , kthread_next );
+      thread_unregister( thread );
 
       // -- just free the kernel stack of the forked thread -- //
-      sfree( thread , PAGE_SIZE * KTHREAD_KSTACK_PAGES );
+      vmm_kstack_free( thread );
     }
 
   }
@@ -402,8 +288,10 @@ void static fault_generic_fatal() {
 
     sem_signal(&task->parentTask->vultures);
   } 
-  else // -- just free the kernel stack of the forked thread -- //
-    sfree( (CURRENT_THREAD) , PAGE_SIZE * KTHREAD_KSTACK_PAGES );
+  else { // -- free the kernel stack of the forked thread once off it -- //
+    disable_preemption();
+    vmm_kstack_free_self();
+  }
 
   schedule(CURRENT_NOT_RUNNABLE); // -- deschedule self and yield to next runnable thread -- //
 
@@ -535,16 +423,24 @@ KERN_RET_CODE faulthandler_init() {
   KERN_RET_CODE ret;
   FN_ENTRY();
 
-  //-- make some room for copy area --//
-  copy_area = smemalign(PAGE_SIZE,PAGE_SIZE * 2);
-  if(!copy_area)
-    return KERN_NO_MEM;
-
   //-- Install the handlers --//
   for(i=0;i<20;i++) {
     if(i == FAULT_DF) 
       continue; 
 
+    //-- these push an error code; pf_wrapper passes it on and pops it --//
+    if(faulthandler_table[i].fn_address == (GENERIC_FN_CALL_ADDRESS)page_fault_handler) {
+      ret = i386_set_idt_entry((char *) idt_base(),
+			       SEGSEL_KERNEL_CS,
+			       &pf_wrapper,
+			       faulthandler_table[i].fault_nr,
+			       i386_GATE_TYPE_TRAP,
+			       i386_PL0);
+      if(ret != KERN_SUCCESS)  
+	return ret;
+      continue;
+    }
+
     ret = i386_install_isr((void *) (faulthandler_table[i].fn_address),
 			   faulthandler_table[i].fault_nr,
 			   i386_GATE_TYPE_TRAP,
@@ -82,6 +82,20 @@ union _i386_context {
 }PACKED;
 typedef union _i386_context i386_context;
 
+
+//-- what pf_wrapper hands its C handler; esp and ss are only pushed --//
+//-- by faults taken in user mode --//
+struct _i386_fault_frame {
+  i386_context context;
+  STACK_ELT    error_code;
+  STACK_ELT    eip;
+  STACK_ELT    cs;
+  STACK_ELT    eflags;
+  STACK_ELT    esp;
+  STACK_ELT    ss;
+}PACKED;
+typedef struct _i386_fault_frame i386_fault_frame;
+
 #endif // ASSEMBLER
 
 #endif // __SAVE_RESTORE
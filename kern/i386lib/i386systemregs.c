@@ -249,3 +249,21 @@ KERN_RET_CODE i386_install_isr(
   FN_LEAVE();
   return ret;
 }
+
+
+/** @function  i386_ex_fixup
+ *  @brief     Looks up where a faulting user memory copy resumes
+ *  @param     eip address of the faulting instruction
+ *  @return    address to resume at; 0 if eip is not a user memory copy
+ */
+
+unsigned long i386_ex_fixup(unsigned long eip)
+{
+  i386_ex_entry *entry;
+
+  for( entry = i386_ex_table ; entry < i386_ex_table_end ; entry++ )
+    if( entry->insn == eip )
+      return entry->fixup;
+
+  return 0;
+}
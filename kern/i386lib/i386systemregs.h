@@ -180,6 +180,21 @@ extern char iw_patchoffset;
 extern char iw_end;
 extern char iw_next_instroffset;
 
+//-- user memory copies; see i386uaccess.S --//
+struct _i386_ex_entry {
+  unsigned long insn;                 //-- instruction that may fault --//
+  unsigned long fixup;                //-- where it resumes if it does --//
+}PACKED;
+typedef struct _i386_ex_entry i386_ex_entry;
+
+extern char pf_wrapper;
+extern i386_ex_entry i386_ex_table[];
+extern i386_ex_entry i386_ex_table_end[];
+int i386_copy_user(void *dst,const void *src,int len);
+int i386_strncpy_user(char *dst,const char *src,int max);
+int i386_strnlen_user(const char *src,int max);
+unsigned long i386_ex_fixup(unsigned long eip);
+
 
 //------------------------------------------------------------------------------
 // PTE PDE PDBR
@@ -12,10 +12,26 @@
 
 KERN_RET_CODE load_elf(ktask         *task , 
 		       char          *fname ,
+		       unsigned long  arg_bytes ,
 		       unsigned long *start_address,
 		       unsigned long *u_stack
 		       );
 
+//-- the two halves of load_elf; used where the task to load into --//
+//-- does not exist until the file is known to load (spawn)        --//
+KERN_RET_CODE load_elf_stage(char           *fname ,
+			     unsigned long   arg_bytes ,
+			     vmm_exec_stage *stage ,
+			     task_vm        *layout ,
+			     unsigned long  *start_address
+			     );
+
+void load_elf_commit(ktask          *task ,
+		     vmm_exec_stage *stage ,
+		     task_vm        *layout ,
+		     unsigned long  *u_stack
+		     );
+
 
 
 #endif // _LOADER_INTERNAL_H
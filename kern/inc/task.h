@@ -54,10 +54,12 @@ typedef struct kthread {
                                  //conditionally loading pdbr//
   Q_NEW_LINK( kthread ) kthread_next;
   Q_NEW_LINK( kthread ) kthread_wait;
+  Q_NEW_LINK( kthread ) kthread_live;  //- on the live thread list -//
 
   kthread_state state;
   int           sleepticks;
   int           run_flag;
+  struct kthread *kstack_dead_next; //- vanished, stack not yet freed -//
 }kthread; 
 
 
@@ -97,6 +99,10 @@ extern uint32_t get_ebp(void);
 int is_idle_thread(); 
 kthread * get_idle_thread();
 
+void thread_register(kthread *thread);
+void thread_unregister(kthread *thread);
+kthread * thread_lookup(int tid);
+
 void thread_setup_iret_frame(kthread   *thread,
 			     STACK_ELT  user_stack,
 			     STACK_ELT  retIP,
@@ -10,36 +10,204 @@
 #define _VMM_H
 #include <kern_common.h>
 #include <x86/page.h>
+#include <memstats.h>
+#include <rmap.h>
+#include <wss.h>
 
 #define KERNEL_PAGES_NR     (USER_MEM_START / PAGE_SIZE)
 #define KTHREAD_KSTACK_PAGES 2
 #define INITIAL_PDE_PAGES    1
 #define PTE_PER_PAGE         (PAGE_SIZE/sizeof(PTE))
+#define KERNEL_PTE_PAGES     ((KERNEL_PAGES_NR + PTE_PER_PAGE - 1) / PTE_PER_PAGE)
+
+//-- page tables live in the kernel direct map --//
+#define PTE_PAGE_PFN(pte_page) ((unsigned long)(pte_page) >> PAGING_PAGE_OFFSET_BITS)
+#define PDE_PTE_PAGE(pde)      ((PTE *)((unsigned long)(pde)->ADDRESS << PAGING_PAGE_OFFSET_BITS))
+
+//-- 4MB (PSE) mappings; a large PDE maps one max order buddy block --//
+#define LARGE_PAGE_SIZE        (PAGE_SIZE * PTE_PER_PAGE)
+#define LARGE_PAGE_MASK        (LARGE_PAGE_SIZE - 1)
+#define LARGE_PAGE_ORDER       VMM_BUDDY_MAX_ORDER
+#define PDE_IS_LARGE(pde)      ((pde)->PRESENT && (pde)->_PAGE_SIZE)
+
+//-- kmap window slots --//
+#define KMAP_SRC_SLOT        0
+#define KMAP_DST_SLOT        1
+#define KMAP_SLOTS           2
 typedef unsigned int PFN;
 
+//-- first frame handed out to user mode and the free list terminator --//
+#define USER_FIRST_PFN       (KERNEL_PAGES_NR + 1)
+#define PFN_NULL             0
+
+//-- buddy allocator orders 0 .. VMM_BUDDY_MAX_ORDER --//
+#define VMM_BUDDY_ORDERS     MEMSTATS_NR_ORDERS
+#define VMM_BUDDY_MAX_ORDER  (VMM_BUDDY_ORDERS - 1)
+#define ORDER_PAGES(order)   (1 << (order))
+
+//-- pre-zeroed frame pool --//
+#define VMM_ZERO_POOL_PAGES  64     //- frames kept zeroed ahead of time  -//
+#define VMM_ZERO_POOL_LOW    256    //- free frames left alone by refill -//
+#define VMM_ZERO_POOL_BATCH  4      //- frames zeroed per idle iteration -//
+
+//-- fault-around window; a power of 2 up to PTE_PER_PAGE pages --//
+#define VMM_FAULT_AROUND_PAGES  16     //- default window of a new range    -//
+#define VMM_FAULT_AROUND_LOW    256    //- free frames below which it stops -//
+#define VMM_FAULT_AROUND_SEQ    128    //- window of a range read in order  -//
+
+//-- pending invalidations above this are done by one full flush --//
+#define VMM_TLB_BATCH_PAGES  32
+
+//-- exec staging; see vmm_exec_stage --//
+#define VMM_EXEC_STAGE_RANGES 4     //- text, rodata, data+bss, stack    -//
+#define VMM_EXEC_STAGE_PAGES  8     //- pages backed when the exec commits -//
+
+//-- swap; see vmm_swap.c --//
+#define VMM_SWAP_DISK_PAGES   1024  //- frames withheld as the RAM disk    -//
+#define VMM_SWAP_DISK_MIN     4096  //- user frames needed to withhold it  -//
+#define VMM_SWAP_ZPOOL_BYTES  (256 * 1024) //- kernel memory for compressed pages -//
+#define VMM_SWAP_ZCHUNK       64    //- allocation unit of the zpool        -//
+#define VMM_SWAP_ZENTRIES     2048  //- compressed pages held at most      -//
+#define VMM_SWAP_BATCH        16    //- frames freed per reclaim            -//
+
+//-- a not present PTE with AVAIL set holds a swap handle in ADDRESS --//
+#define PTE_AVAIL_SWAP        0x1
+#define PTE_IS_SWAPPED(pte)   (!(pte)->PRESENT && ((pte)->AVAIL & PTE_AVAIL_SWAP))
+
+//-- same page merging; see vmm_ksm.c --//
+#define VMM_KSM_BUCKETS       1024  //- frames remembered by hash           -//
+#define VMM_KSM_BATCH         8     //- frames hashed per idle iteration    -//
+#define VMM_KSM_LOOK          256   //- frames looked at per idle iteration -//
+#define VMM_KSM_MIN_AGE       2     //- sampler passes a page sat untouched -//
+
+//-- working set sampling; see vmm_wss.c --//
+#define VMM_WSS_SCAN_SLOTS    256   //- PTEs looked at per timer tick      -//
+#define VMM_WSS_AGE_MAX       (WSS_AGE_BINS - 1)
+
+//-- a present PTE keeps in AVAIL the passes it went untouched --//
+#define PTE_AGE_SHIFT         1
+#define PTE_AGE(pte)          (((pte)->AVAIL >> PTE_AGE_SHIFT) & VMM_WSS_AGE_MAX)
+#define PTE_SET_AGE(pte,age)  ((pte)->AVAIL = ((pte)->AVAIL & PTE_AVAIL_SWAP) | \
+                                              ((age) << PTE_AGE_SHIFT))
+
+//-- object caches; see vmm_cache.c --//
+#define VMM_CACHE_BIG_OBJS    4     //- page sized objects carved per slab  -//
+#define VMM_EXEC_ARGS_BYTES   PAGE_SIZE //- exec arguments served by a cache -//
+#define VMM_KSTACK_CACHED     8     //- free thread stacks kept for reuse   -//
+
+//-- growable stacks; see vmm_grow_range --//
+#define VMM_STACK_MAX_PAGES    1024 //- largest a stack may grow to       -//
+#define VMM_STACK_WINDOW_PAGES 32   //- faults this far below it grow it  -//
+#define VMM_STACK_GROW_PAGES   8    //- least it grows by at a time       -//
+#define VMM_STACK_GUARD_PAGES  1    //- unmapped gap kept below it        -//
+
+//-- shared memory segments; see vmm_shm.c --//
+#define VMM_SHM_MAX_SEGMENTS   64   //- segments alive at once            -//
+#define VMM_SHM_MAX_PAGES      1024 //- largest a segment may be          -//
+
+//-- vm_range flags --//
+#define VM_RANGE_LARGE       0x1    //- backed by 4MB pages up front     -//
+#define VM_RANGE_GROWSDOWN   0x2    //- stack; grows down on faults below -//
+#define VM_RANGE_SHARED      0x4    //- maps a shared memory segment      -//
+
+//-- m_page flags --//
+#define M_PAGE_BUDDY_FREE    0x1    //- head of a free buddy block -//
+
 
 Q_NEW_HEAD( vm_ranges_head , vm_range );
 
+// -- one mapping of a frame; see vmm_rmap.c -- //
+// -- a user frame records the PTE slots mapping it (pte set) -- //
+// -- a page table records the VMs whose PDEs point at it, and -- //
+// -- the head frame of a 4MB page the VMs mapping it whole     -- //
+typedef struct _vmm_rmap {
+  struct _vmm_rmap *next;
+  struct task_vm   *vm;           //- owner; NULL for a PTE slot    -//
+  unsigned long     address;      //- 4MB aligned user address      -//
+  PTE              *pte;          //- slot mapping the frame or NULL -//
+}vmm_rmap;
+
 // -- refcount used in COW setup -- //
+// -- next/prev thread free block heads into the buddy free lists -- //
+// -- next also threads frames on the pre-zeroed pool -- //
+// -- rmap chains the mappings of the frame; the zero frame has none -- //
 struct _m_page {
-  volatile int refcount;
+  volatile int  refcount;
+  PFN           next;
+  PFN           prev;
+  unsigned char order;
+  unsigned char flags;
+  vmm_rmap     *rmap;
 }PACKED;
 
 typedef struct _m_page m_page;
 
+// -- read only frames of one program, shared by all its instances -- //
+// -- the cache holds a reference on every frame it keeps -- //
+typedef struct vmm_image {
+  const char    *execbytes;       //- program in exec2obj; NULL if unused -//
+  unsigned long  start;           //- first read only user page         -//
+  int            nr_pages;
+  int            nr_cached;       //- frames held right now             -//
+  PFN           *frames;          //- PFN_NULL where not cached         -//
+}vmm_image;
+
+// -- frames shared by every task that attached the segment -- //
+// -- the segment holds a reference on each of its frames and  -- //
+// -- every range mapping it holds a reference on the segment  -- //
+typedef struct vmm_shm {
+  struct vmm_shm *next;
+  int             id;
+  int             refs;           //- ranges mapping it, plus lookups -//
+  int             nr_pages;
+  PFN            *frames;
+}vmm_shm;
+
 // -- each vm range node contains the range of memory used by a task's VM -- //
 // -- growing VM adds nodes to VQ implementation with info on range accessible -- //   
+// -- user ranges are also kept in a per task interval tree -- //
 typedef struct vm_range {
   Q_NEW_LINK( vm_range ) vm_range_next;
   unsigned long start;
   unsigned long len; 
+  int           fault_around;     //- pages backed per demand fault -//
+  int           flags;            //- VM_RANGE_* -//
+
+  //- executable image bytes backing the range; NULL for anonymous -//
+  //- bytes past file_len up to the end of the range read as zero  -//
+  const char   *file_bytes;
+  unsigned long file_start;       //- user address of file_bytes[0] -//
+  unsigned long file_len;
+  vmm_image    *image;            //- shared read only frames; may be NULL -//
+
+  //- VM_RANGE_GROWSDOWN only -//
+  unsigned long grow_floor;       //- lowest start it may grow down to -//
+  int           grow_window;      //- pages below start a fault grows it -//
+
+  //- VM_RANGE_SHARED only -//
+  vmm_shm      *shm;              //- frames are never copied on write -//
+
+  struct vm_range *tree_left;
+  struct vm_range *tree_right;
+  unsigned long    tree_max_end;  //- largest end in this subtree -//
+  int              tree_height;
 }vm_range; 
 
+// -- working set sampled from the accessed bits; see vmm_wss.c -- //
+// -- the pass in progress counts into pass; a finished pass is -- //
+// -- copied into last                                           -- //
+typedef struct _vmm_wss {
+  unsigned long cursor;           //- next user address to look at -//
+  wss_stats_t   pass;
+  wss_stats_t   last;
+}vmm_wss;
+
 // -- the actual VM manager struct that is a part of each task -- //
 
 struct task_vm {
   vm_ranges_head vm_ranges_head;
   vm_range       vm_range_kernel;  //0-USER_MEM_START
+  vm_range      *vm_range_root;    //- interval tree of user ranges -//
 
   //- Initial exec ranges --//
   unsigned long vm_text_start; 
@@ -59,26 +227,269 @@ struct task_vm {
   PDE   *pde_base;
   char  *taskmem;
   int    totalTaskAllocation;
+
+  vmm_wss wss;
 }; 
 
 
+// -- TLB invalidations collected during one VM operation -- //
+// -- frames unmapped meanwhile are released after the flush -- //
+typedef struct _tlb_batch {
+  struct task_vm *vm;
+  int             nr_pages;     //- pages pending; > BATCH means full -//
+  unsigned long   pages[VMM_TLB_BATCH_PAGES];
+  int             nr_frames;
+  PFN             frames[VMM_TLB_BATCH_PAGES];
+}tlb_batch;
+
+// -- everything an exec needs to build the new user space, gathered -- //
+// -- while the old one is still intact so failure can be reported -- //
+typedef struct _vmm_exec_stage {
+  int            nr_ranges;
+  vm_range      *ranges[VMM_EXEC_STAGE_RANGES];  //- not linked yet       -//
+  PTE           *pte_reserve;   //- zeroed page tables chained by first word -//
+  vmm_rmap      *rmap_reserve;  //- one per staged page table and page    -//
+  int            nr_pages;
+  unsigned long  page_addr[VMM_EXEC_STAGE_PAGES];
+  PFN            page_pfn[VMM_EXEC_STAGE_PAGES];  //- zeroed frames         -//
+}vmm_exec_stage;
+
+// -- free list of buddy blocks of one order -- //
+typedef struct _buddy_free_area {
+  PFN head;
+  int nr_free;             //- blocks on this list -//
+}buddy_free_area;
+
+// -- free list of fixed size objects; see vmm_cache.c -- //
+typedef struct _vmm_cache {
+  const char   *name;
+  unsigned int  size;
+  unsigned int  align;
+  int           per_slab;     //- objects carved from one allocation  -//
+  int           max_free;     //- free objects kept; more go to lmm   -//
+  void        (*ctor)(void *obj);
+  void         *free_list;    //- linked through the first word       -//
+  int           nr_free;
+  int           nr_active;    //- objects handed out right now        -//
+  int           hits;         //- allocations served by the free list -//
+  int           grows;        //- slabs carved                        -//
+  int           releases;     //- frees handed back to lmm            -//
+  struct _vmm_cache *next;    //- every cache, for the statistics     -//
+}vmm_cache;
+
 // -- VMM Manager for the kernel -- //
 typedef struct _kern_vmm { 
   m_page *m_pages;
   int nr_physical_pages; 
-  int nr_free_pages; 
-  PFN next_free_page;
+  int nr_user_pages;       //- frames managed by the buddy allocator -//
+  int nr_free_pages;       //- frames on the free lists              -//
+  buddy_free_area free_area[VMM_BUDDY_ORDERS];
+
+  //- direct map page tables shared by every task -//
+  PTE *kernel_pte_base;
+
+  //- window used to reach user frames from the kernel -//
+  //- its 4MB stays on page tables; the rest of the     -//
+  //- direct map uses large pages                       -//
+  char *kmap_window;
+  int   kmap_pde_idx;
+
+  //- shared zero filled frame -//
+  PFN zero_pfn;
+  int zero_page_maps;      //- read faults served by the zero frame  -//
+  int zero_page_breaks;    //- writes that replaced it with a frame  -//
+
+  //- frames zeroed by the idle thread -//
+  PFN zero_pool_head;
+  int zero_pool_nr;
+  int zero_pool_hits;      //- zeroed frames handed out from the pool -//
+  int zero_pool_misses;    //- zeroed frames cleared on demand        -//
+
+  //- fault-around -//
+  int fault_around_faults; //- faults that mapped neighbouring pages -//
+  int fault_around_pages;  //- neighbouring pages mapped by them      -//
+
+  //- hints given by madvise -//
+  int prefaulted_pages;    //- pages backed ahead of use               -//
+  int dropped_pages;       //- pages whose frames were given back      -//
+
+  //- copy on write breaks -//
+  int cow_copies;          //- shared frames copied                   -//
+  int cow_promotions;      //- frames made writable by the last owner -//
+
+  //- demand paged executables -//
+  int file_page_fills;     //- frames filled from an executable image -//
+  int image_frames;        //- read only frames held by the cache     -//
+  int image_hits;          //- faults that mapped a cached frame      -//
+  int image_misses;        //- faults that had to fill one            -//
+  int image_evictions;     //- cached frames given back under pressure -//
+
+  //- reverse mappings -//
+  int rmap_entries;        //- mappings recorded right now            -//
+  vmm_rmap *rmap_spare;    //- entries kept for reuse; see vmm_rmap.c -//
+
+  //- swap -//
+  PFN swap_disk_base;      //- first frame of the RAM disk            -//
+  int swap_disk_pages;     //- 0 when there is no RAM disk            -//
+  int swap_disk_used;      //- RAM disk slots holding a page          -//
+  int swap_zpages;         //- pages held compressed                  -//
+  int swap_zbytes;         //- zpool bytes they take up               -//
+  int swap_outs;           //- frames written out and freed           -//
+  int swap_ins;            //- pages read back on a fault             -//
+  int swap_failures;       //- reclaims that found nothing to evict   -//
+
+  //- same page merging -//
+  int ksm_sweeps;          //- times the idle scan went over all frames -//
+  int ksm_merges;          //- frames freed into an identical frame     -//
+  int ksm_zero_merges;     //- frames of zeroes freed for the zero frame -//
+
+  //- object caches -//
+  vmm_cache *caches;           //- chain of every cache    -//
+  vmm_cache  range_cache;      //- vm_range nodes          -//
+  vmm_cache  pte_cache;        //- zeroed page table pages -//
+  vmm_cache  kstack_cache;     //- kernel thread stacks    -//
+  vmm_cache  exec_args_cache;  //- exec argument copies    -//
+
+  //- shared memory; see vmm_shm.c -//
+  vmm_shm *shm_segments;   //- every segment alive                    -//
+  int shm_next_id;
+  int shm_nr_segments;
+  int shm_frames;          //- frames held by segments                -//
+  int shm_maps;            //- faults that mapped a segment frame     -//
+
+  //- stacks of vanished threads; see vmm_kstack.c -//
+  struct kthread *kstack_dead;
+  int kstack_reaped;       //- stacks freed after their thread vanished -//
+
+  //- TLB -//
+  int tlb_global;          //- CR4.PGE is on                          -//
+  int tlb_invlpgs;         //- single page invalidations               -//
+  int tlb_full_flushes;    //- cr3 reloads to flush an address space   -//
+  int tlb_skipped;         //- batches for an address space not loaded -//
+  int tlb_switches;        //- address space switches; with PGE the    -//
+                           //- kernel entries survive every one of them -//
 }kern_vmm; 
 
 typedef struct ktask ktask;
 
 
 //- USER PAGE MANAGEMENT -//
+void          vmm_buddy_init(void);
+KERN_RET_CODE vmm_alloc_user_pages(int order,PFN *pfn);
+void          vmm_free_user_pages(PFN pfn,int order);
 KERN_RET_CODE vmm_get_free_user_pages(PFN *pfn);
 void vmm_getref_user_page(PFN pfn);
 void vmm_putref_user_page(PFN pfn);
-
-
+int  vmm_nr_free_user_pages(void);
+void vmm_get_memstats(memstats_t *stats);
+void vmm_copy_user_page(PFN dst_pfn,PFN src_pfn);
+void vmm_zero_user_page(PFN pfn);
+void vmm_fill_user_page(PFN pfn,int offset,const char *src,int len);
+void vmm_read_user_page(PFN pfn,int offset,char *dst,int len);
+uint32_t vmm_hash_user_page(PFN pfn,int *zero);
+int  vmm_same_user_pages(PFN pfn1,PFN pfn2);
+
+//- PRE-ZEROED FRAMES -//
+KERN_RET_CODE vmm_get_zeroed_user_page(PFN *pfn);
+int           vmm_zero_pool_refill(int budget);
+int           vmm_zero_pool_reclaim(void);
+
+//- PROGRAM IMAGE CACHE -//
+vmm_image    *vmm_image_get(const char *execbytes,unsigned long start,unsigned long len);
+PFN           vmm_image_lookup(vmm_image *image,unsigned long page);
+void          vmm_image_insert(vmm_image *image,unsigned long page,PFN pfn);
+int           vmm_image_reclaim(void);
+
+//- REVERSE MAPPINGS -//
+//- adds may block; reserve entries up front where failing is not an option -//
+KERN_RET_CODE vmm_rmap_reserve(vmm_rmap **pool,int nr);
+void          vmm_rmap_release(vmm_rmap **pool);
+void          vmm_rmap_link(vmm_rmap **pool,PFN pfn,struct task_vm *vm,unsigned long address,PTE *pte);
+KERN_RET_CODE vmm_rmap_add(PFN pfn,struct task_vm *vm,unsigned long address,PTE *pte);
+void          vmm_rmap_remove(PFN pfn,struct task_vm *vm,unsigned long address,PTE *pte);
+int           vmm_rmap_detach(PFN pfn);
+void          vmm_rmap_flush_slot(PTE *pte);
+int           vmm_rmap_query(PFN pfn,rmap_mapping_t *buf,int count);
+void          vmm_rmap_dump(PFN pfn);
+
+//- SWAP -//
+void          vmm_swap_init(void);
+int           vmm_swap_reclaim(int nr);
+void          vmm_swap_read(unsigned long handle,PFN pfn);
+void          vmm_swap_dup(unsigned long handle);
+void          vmm_swap_put(unsigned long handle);
+
+//- SAME PAGE MERGING -//
+int           vmm_ksm_scan(int budget);
+
+//- OBJECT CACHES -//
+void          vmm_cache_init(vmm_cache *cache,const char *name,unsigned int size,
+			     unsigned int align,void (*ctor)(void *obj));
+void         *vmm_cache_alloc(vmm_cache *cache);
+void          vmm_cache_free(vmm_cache *cache,void *obj);
+void          vmm_cache_totals(memstats_t *stats);
+void          vmm_cache_dump(void);
+
+//- KERNEL STACKS -//
+struct kthread *vmm_kstack_alloc(void);
+void          vmm_kstack_free(struct kthread *thread);
+void          vmm_kstack_free_self(void);
+int           vmm_kstack_reap(void);
+
+//- SHARED MEMORY -//
+KERN_RET_CODE vmm_shm_create(int nr_pages,vmm_shm **pshm);
+vmm_shm      *vmm_shm_find(int id);
+void          vmm_shm_get(vmm_shm *shm);
+void          vmm_shm_put(vmm_shm *shm);
+KERN_RET_CODE vmm_shm_attach(struct task_vm *vm,vmm_shm *shm,unsigned long start);
+KERN_RET_CODE vmm_shm_detach(struct task_vm *vm,unsigned long start);
+
+//- WORKING SET SAMPLING -//
+void          vmm_wss_tick(struct task_vm *vm);
+void          vmm_wss_get_stats(struct task_vm *vm,wss_stats_t *stats);
+
+//- FAULT RESOLUTION -//
+KERN_RET_CODE vmm_fault_in(struct task_vm *vm,uint32_t address,int write);
+KERN_RET_CODE vmm_fault_in_range(struct task_vm *vm,void *base_addr,int len,int write);
+KERN_RET_CODE vmm_set_fault_around(vm_range *range,int pages);
+int           vmm_prefault_range(struct task_vm *vm,unsigned long start,unsigned long len);
+
+//- USER MEMORY ACCESS -//
+//- these may take page faults; not to be called with preemption disabled -//
+KERN_RET_CODE vmm_copy_from_user(void *dst,const void *usrc,int len);
+KERN_RET_CODE vmm_copy_to_user(void *udst,const void *src,int len);
+int           vmm_strncpy_from_user(char *dst,const char *usrc,int max);
+int           vmm_strnlen_user(const char *usrc,int max);
+
+//- PAGE TABLE PAGES -//
+//- page table pages are refcounted by the PDEs pointing at them -//
+PTE          *vmm_alloc_pte_page(void);
+void          vmm_putref_pte_page(PTE *pte_page);
+KERN_RET_CODE vmm_install_pte_page(struct task_vm *vm,uint32_t address);
+KERN_RET_CODE vmm_share_user_ptes(struct task_vm *dst,struct task_vm *src);
+KERN_RET_CODE vmm_unshare_pte_page(struct task_vm *vm,uint32_t address);
+
+//- TLB -//
+void vmm_tlb_enable_global(void);
+void vmm_tlb_batch_init(tlb_batch *batch,struct task_vm *vm);
+void vmm_tlb_batch_add(tlb_batch *batch,unsigned long address,PFN pfn);
+void vmm_tlb_batch_flush(tlb_batch *batch);
+void vmm_tlb_flush_page(struct task_vm *vm,unsigned long address);
+void vmm_tlb_flush_all(struct task_vm *vm);
+void vmm_tlb_count_switch(void);
+
+//- LARGE PAGES -//
+KERN_RET_CODE vmm_install_large_range(struct task_vm *vm,vm_range *range);
+KERN_RET_CODE vmm_unshare_large_page(struct task_vm *vm,uint32_t address);
+KERN_RET_CODE vmm_split_large_page(struct task_vm *vm,uint32_t address);
+
+
+//- IN PLACE EXEC -//
+void          vmm_exec_stage_init(vmm_exec_stage *stage);
+KERN_RET_CODE vmm_exec_stage_range(vmm_exec_stage *stage,vm_range *range);
+KERN_RET_CODE vmm_exec_stage_back(vmm_exec_stage *stage,unsigned long start,unsigned long len);
+void          vmm_exec_stage_abort(vmm_exec_stage *stage);
+void          vmm_exec_commit(struct task_vm *vm,vmm_exec_stage *stage);
 
 //- KERN TASK ALLOC and FREE -//
 KERN_RET_CODE vmm_init_task_vm(ktask *parentTask,ktask **ppKtask);
@@ -98,6 +509,7 @@ KERN_RET_CODE vmm_init(void);
 KERN_RET_CODE vmm_install_range(struct task_vm *,vm_range *);
 KERN_RET_CODE vmm_uninstall_range(struct task_vm *,vm_range*);
 KERN_RET_CODE vmm_free_user_ptes(struct task_vm*);
+KERN_RET_CODE vmm_drop_pages(struct task_vm *,unsigned long start,unsigned long len);
 
 
 
@@ -134,8 +546,31 @@ KERN_RET_CODE vmm_share_physical_range(struct task_vm *vm_dst,
 
 // --Address range checking functions --//
 vm_range *vmm_get_range( struct task_vm *vm , char *address );
+vm_range *vmm_get_overlapping_range( struct task_vm *vm , void *base_addr , int len );
+vm_range *vmm_get_growable_range( struct task_vm *vm , unsigned long address );
+KERN_RET_CODE vmm_grow_range( struct task_vm *vm , unsigned long address );
 KERN_RET_CODE vmm_is_range_present( struct task_vm *vm , void *base_addr , int len );
 int  vmm_is_address_ro( struct task_vm *vm , void *base_addr );
+
+//-- Interval tree of user ranges --//
+void      vmm_range_tree_insert(struct task_vm *vm,vm_range *range);
+void      vmm_range_tree_remove(struct task_vm *vm,vm_range *range);
+vm_range *vmm_range_tree_lookup(struct task_vm *vm,unsigned long address);
+vm_range *vmm_range_tree_overlap(struct task_vm *vm,
+				 unsigned long start,
+				 unsigned long end);
+int       vmm_range_tree_overlap_all(struct task_vm *vm,
+				     unsigned long start,
+				     unsigned long end,
+				     vm_range **ranges,
+				     int max);
+vm_range *vmm_range_tree_find_start(struct task_vm *vm,unsigned long start);
+vm_range *vmm_range_tree_next(struct task_vm *vm,unsigned long address);
+vm_range *vmm_range_tree_prev(struct task_vm *vm,unsigned long address);
+void      vmm_range_tree_resize(struct task_vm *vm,
+				vm_range *range,
+				unsigned long start,
+				unsigned long len);
 #endif // _VMM_H
 
 
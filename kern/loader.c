@@ -21,6 +21,35 @@
 #include <stddef.h>
 
 
+/** @function  loader_find_image
+ *  @brief     This function looks up a file in the exec2obj table of contents
+ *  @param     filename - the name of the file
+ *  @return    the TOC entry; NULL if there is no such readable file
+ */
+
+static const exec2obj_userapp_TOC_entry *loader_find_image(const char *filename) {
+  int index;
+
+  for(index = 0; index < exec2obj_userapp_count; index++) {
+    if(!strcmp(filename, exec2obj_userapp_TOC[index].execname))
+      break;
+  }
+
+  if(index == exec2obj_userapp_count) {
+    DUMP("Executalble not found %s!!",filename);
+    return NULL;
+  }
+
+  // -- does this file have any data -- //
+  if((char *)exec2obj_userapp_TOC[index].execbytes == NULL) {
+    DUMP("Executalble cannot be read %s!!",filename);
+    return NULL;
+  }
+
+  return &exec2obj_userapp_TOC[index];
+}
+
+
 /** @function  getbytes
  *  @brief     This function copies data from a file into a buffer.
  *
@@ -33,328 +62,285 @@
  */
 
 int getbytes( const char *filename, int offset, int size, char *buf ) {
-  int index;
-  int found = 0;
+  const exec2obj_userapp_TOC_entry *image;
   
   FN_ENTRY();
-  index = 0;
 
   // -- find the file -- //
-  while(index < exec2obj_userapp_count) {
-    // match //
-    if(!strcmp(filename, exec2obj_userapp_TOC[index].execname)) {
-      found = 1;
-      break;
-    }
-    index++;
-  }
-
-  if(!found)  {
-    DUMP("Executalble not found %s!!",filename);
+  image = loader_find_image(filename);
+  if(!image)
     return -1;
-  }
-
-  // -- does this file have any data -- //
-  if((char *)exec2obj_userapp_TOC[index].execbytes == NULL) {
-    DUMP("Executalble cannot be read %s!!",filename);
-    return -1;
-  }
 
   // -- copy stuff over -- //
   memcpy(buf,
-	 (char *)exec2obj_userapp_TOC[index].execbytes + offset,
+	 (char *)image->execbytes + offset,
 	 size);
 
   FN_LEAVE();
   return size;
 }
 
-/** @function  loader_install_ranges
- *  @brief     This function installs the different ELF sections of the file
- *             into the VM of the supplied task
+/** @function  loader_set_image
+ *  @brief     This function points a range at the bytes of an ELF section
+ *             in the exec2obj image; its pages are filled on first touch
+ *  @param     range - range about to be installed
+ *  @param     image - TOC entry of the executable
+ *  @param     start - user address the section is loaded at
+ *  @param     off   - offset of the section in the file
+ *  @param     len   - bytes of the section in the file
+ *  @return    KERN_SUCCESS on success; KERN_NOT_AN_ELF if the section
+ *             lies outside the file
+ */
+
+static KERN_RET_CODE loader_set_image(vm_range *range,
+				      const exec2obj_userapp_TOC_entry *image,
+				      unsigned long start,
+				      unsigned long off,
+				      unsigned long len) {
+  if( off > (unsigned long)image->execlen ||
+      len > (unsigned long)image->execlen - off )
+    return KERN_NOT_AN_ELF;
+
+  range->file_bytes = image->execbytes + off;
+  range->file_start = start;
+  range->file_len   = len;
+  return KERN_SUCCESS;
+}
+
+
+/** @function  loader_stage_ranges
+ *  @brief     This function stages the different ELF sections of the file
+ *             for an in place exec. Nothing is backed but the stack;
+ *             text, rodata and data are filled from the exec2obj image on
+ *             first touch and bss is demand zero. Text and rodata frames
+ *             are shared through the program image cache
  *
- *  @param     vm - pointer to the VM manager of a task
- *  @param     fname - name of the file in the ramdisk that must be loaded
+ *  @param     stage  - exec being staged
+ *  @param     layout - placeholder for the vm_*_start/len of the new program
+ *  @param     se_hdr - the ELF header of the file
+ *  @param     image  - TOC entry of the file
+ *  @param     arg_bytes - stack the arguments take; all of it is backed
  *
  *  @return    KERN_SUCCESS on success 
  *             Else an appropriate error code on failure
  */
 
-KERN_RET_CODE loader_install_ranges( task_vm *vm , char *fname )  {
+static KERN_RET_CODE loader_stage_ranges( vmm_exec_stage *stage ,
+					  task_vm        *layout ,
+					  simple_elf_t   *se_hdr ,
+					  const exec2obj_userapp_TOC_entry *image ,
+					  unsigned long   arg_bytes )  {
   KERN_RET_CODE ret;
-  simple_elf_t se_hdr;
-  vm_range     vm_range;
-  PDE          attr;
-
-  if( ELF_SUCCESS != elf_check_header( fname ) )  {
-    DUMP(" elf_check_header failed %s", fname);
-    return KERN_NOT_AN_ELF;
-  }
-  
-  //-- read the header --//
-  if( ELF_SUCCESS != elf_load_helper(&se_hdr,fname) ) {
-    DUMP(" elf_load_helper failed %s", fname);
-    return KERN_NOT_AN_ELF;
-  }
+  vm_range      vm_range;
+  unsigned long ro_start;
+  unsigned long ro_end;
+  unsigned long stack_len;
+
+  memset(&vm_range,0,sizeof(vm_range));
+
+  //-- text and rodata pages are shared by every instance --//
+  ro_start = se_hdr->e_txtstart;
+  ro_end   = se_hdr->e_txtstart + se_hdr->e_txtlen;
+  if( se_hdr->e_rodatstart < ro_start )
+    ro_start = se_hdr->e_rodatstart;
+  if( se_hdr->e_rodatstart + se_hdr->e_rodatlen > ro_end )
+    ro_end = se_hdr->e_rodatstart + se_hdr->e_rodatlen;
+  ro_start = ro_start & ~PAGE_MASK;
+  ro_end   = ( ro_end + PAGE_SIZE - 1 ) & ~PAGE_MASK;
+  vm_range.image = vmm_image_get(image->execbytes,ro_start,ro_end - ro_start);
 
-  //-- Install all the user mode ranges in new vm --//
   //-- .text
-  vm_range.start  = se_hdr.e_txtstart;
-  vm_range.len    = se_hdr.e_txtlen;
-  ret = vmm_install_range(vm,&vm_range);
+  vm_range.start  = se_hdr->e_txtstart;
+  vm_range.len    = se_hdr->e_txtlen;
+  ret = loader_set_image(&vm_range,image,
+			 se_hdr->e_txtstart,se_hdr->e_txtoff,se_hdr->e_txtlen);
+  if(KERN_SUCCESS == ret)
+    ret = vmm_exec_stage_range(stage,&vm_range);
   if(KERN_SUCCESS != ret) {
-    DUMP("failed to install text range");
-    goto err;
+    DUMP("failed to stage text range");
+    return ret;
   }
-  vm->vm_text_start = vm_range.start; 
-  vm->vm_text_len   = vm_range.len;
-  //--  set attributes --//
-  memset(&attr,0,sizeof(attr));
-  attr.PRESENT      = 1;
-  attr.RW           = 1;
-  attr.US           = 1;
-  attr.GLOBAL       = 0;
-  vmm_set_range_attr( vm , &vm_range , attr );
+  layout->vm_text_start = vm_range.start; 
+  layout->vm_text_len   = vm_range.len;
 
   //-- .rodata
-  vm_range.start  = se_hdr.e_rodatstart;
-  vm_range.len    = se_hdr.e_rodatlen;
-  ret = vmm_install_range(vm,&vm_range);
+  vm_range.start  = se_hdr->e_rodatstart;
+  vm_range.len    = se_hdr->e_rodatlen;
+  ret = loader_set_image(&vm_range,image,
+			 se_hdr->e_rodatstart,se_hdr->e_rodatoff,se_hdr->e_rodatlen);
+  if(KERN_SUCCESS == ret)
+    ret = vmm_exec_stage_range(stage,&vm_range);
   if(KERN_SUCCESS != ret) {
-    DUMP("failed to install readonly data range");
-    goto err;
+    DUMP("failed to stage readonly data range");
+    return ret;
   }
-  vm->vm_rdata_start = vm_range.start; 
-  vm->vm_rdata_len   = vm_range.len;
-  //--  set attributes --//
-  memset(&attr,0,sizeof(attr));
-  attr.PRESENT      = 1;
-  attr.RW           = 1;
-  attr.US           = 1;
-  attr.GLOBAL       = 0;
-  vmm_set_range_attr( vm , &vm_range , attr );
+  layout->vm_rdata_start = vm_range.start; 
+  layout->vm_rdata_len   = vm_range.len;
 
 
   //-- .heap
   //-- .bss
-  vm_range.start  = se_hdr.e_datstart;
-  vm_range.len    = se_hdr.e_datlen + se_hdr.e_bsslen;
-  ret = vmm_install_range(vm,&vm_range);
+  //-- data comes from the image; bss past it reads as zero
+  //-- it is written to, so every instance has its own copy
+  vm_range.image  = NULL;
+  vm_range.start  = se_hdr->e_datstart;
+  vm_range.len    = se_hdr->e_datlen + se_hdr->e_bsslen;
+  ret = loader_set_image(&vm_range,image,
+			 se_hdr->e_datstart,se_hdr->e_datoff,se_hdr->e_datlen);
+  if(KERN_SUCCESS == ret)
+    ret = vmm_exec_stage_range(stage,&vm_range);
   if(KERN_SUCCESS != ret) {
-    DUMP("failed to install data range");
-    goto err;
+    DUMP("failed to stage data range");
+    return ret;
   }
-  vm->vm_data_start = vm_range.start; 
-  vm->vm_data_len   = vm_range.len;
-  //--  set attributes --//
-  memset(&attr,0,sizeof(attr));
-  attr.PRESENT      = 1;
-  attr.RW           = 1;
-  attr.US           = 1;
-  attr.GLOBAL       = 0;
-  vmm_set_range_attr( vm , &vm_range , attr );
-
+  layout->vm_data_start = vm_range.start; 
+  layout->vm_data_len   = vm_range.len;
 
 
   //-- .stack
-  vm_range.len    = KTHREAD_USTACK_PAGES * PAGE_SIZE;
-  vm_range.start  = 0xffffa000;
-  ret = vmm_install_range(vm,&vm_range);
+  //-- one growable range; faults below it extend it down to the floor
+  //-- it starts out big enough to hold the arguments
+  stack_len = ( arg_bytes + PAGE_SIZE - 1 ) & ~PAGE_MASK;
+  if( stack_len < KTHREAD_USTACK_PAGES * PAGE_SIZE )
+    stack_len = KTHREAD_USTACK_PAGES * PAGE_SIZE;
+  vm_range.len    = stack_len;
+  vm_range.start  = 0xffffc000 - stack_len;
+  vm_range.file_bytes = NULL;
+  vm_range.file_len   = 0;
+  vm_range.flags       = VM_RANGE_GROWSDOWN;
+  vm_range.grow_floor  = vm_range.start + vm_range.len -
+                         VMM_STACK_MAX_PAGES * PAGE_SIZE;
+  vm_range.grow_window = VMM_STACK_WINDOW_PAGES;
+  ret = vmm_exec_stage_range(stage,&vm_range);
   if(KERN_SUCCESS != ret) {
-    DUMP("failed to install text range");
-    goto err;
-  }
-  vm->vm_stack_start = vm_range.start; 
-  vm->vm_stack_len   = vm_range.len;
-  //--  set attributes --//
-  memset(&attr,0,sizeof(attr));
-  attr.PRESENT      = 1;
-  attr.RW           = 1;
-  attr.US           = 1;
-  attr.GLOBAL       = 0;
-  vmm_set_range_attr( vm , &vm_range , attr );
-
-
-  //-- back all the ranges with physical pages --//
-  ret = vmm_back_all_user_ranges( vm );
-  if( KERN_SUCCESS != ret ) {
-    goto err;
+    DUMP("failed to stage stack range");
+    return ret;
   }
+  layout->vm_stack_start = vm_range.start; 
+  layout->vm_stack_len   = vm_range.len;
 
-
-  return KERN_SUCCESS;
- err:
-  vmm_unback_all_user_ranges( vm );
-  vmm_free_user_ptes( vm );
-  vmm_free_all_vma( vm );
-  return ret;
+  //-- exec writes argv onto the stack from the kernel; back it;  --//
+  //-- spawn does so in another task's VM, where it must not fault --//
+  return vmm_exec_stage_back(stage,vm_range.start,vm_range.len);
 }
 
-/** @function  load_elf
- *  @brief     This function spawns a new process and loads the elf file sections
- *             into the new task's VM, and then unloads the current task
- *             and vanishes the current task. 
- *  // -- probably redundant design decision   -- //
- *  // -- tweaked to do the right thing, instead of having to rewrite -- // 
+/** @function  load_elf_stage
+ *  @brief     This function stages the elf file sections for an in place
+ *             load. Nothing is changed in any address space yet
  *
- *  @param     task - pointer to task
  *  @param     fname - name of the file in the ramdisk that must be loaded
+ *  @param     arg_bytes - stack the arguments will take
+ *  @param     stage - placeholder for the staged user space
+ *  @param     layout - placeholder for the vm_*_start/len of the new program
  *  @param     start_address - start address of the binary loaded in text section
- *  @param     u_stack - userland stack start address 
  *
- *  @return    KERN_SUCCESS on success 
- *             Else an appropriate error code on failure
+ *  @return    KERN_SUCCESS on success; the stage is handed to
+ *             load_elf_commit or vmm_exec_stage_abort
+ *             Else an appropriate error code on failure; nothing is staged
  */
 
-KERN_RET_CODE load_elf(ktask         *task , 
-		       char          *fname ,
-		       unsigned long *start_address,
-		       unsigned long *u_stack
-		       )
+KERN_RET_CODE load_elf_stage(char           *fname ,
+			     unsigned long   arg_bytes ,
+			     vmm_exec_stage *stage ,
+			     task_vm        *layout ,
+			     unsigned long  *start_address
+			     )
 {
-  KERN_RET_CODE ret;
-  ktask         *vm_task;
-  kthread       *this_thread = CURRENT_THREAD;
-  PDE           attr;
-  simple_elf_t  se_hdr;
-  vm_range      vm_range;
-
-  this_thread = this_thread;
-
+  KERN_RET_CODE  ret;
+  simple_elf_t   se_hdr;
+  const exec2obj_userapp_TOC_entry *image;
 
   if( ELF_SUCCESS != elf_check_header( fname ) )  {
     DUMP(" elf_check_header failed %s", fname);
     return KERN_NOT_AN_ELF;
   }
 
-  ret = vmm_init_task_vm( NULL , &vm_task );
-  if( ret != KERN_SUCCESS )  {
-    DUMP( "task Creation failed %d" , ret );
-    return ret;  
-  }
-
-  //-- Install all the ranges --//
-  ret = loader_install_ranges(&vm_task->vm,fname);
-  if( KERN_SUCCESS != ret ) {
-    goto err;
-  }
-
-  //-- free up the old user space VM mapping of old address space --//
-  ret = vmm_unback_all_user_ranges(&CURRENT_THREAD->pTask->vm);
-  if( ret != KERN_SUCCESS )  {
-    DUMP( "Memory leak Cannot Unback pages from old address space %d" , ret );
-  }
-  ret = vmm_free_user_ptes(&CURRENT_THREAD->pTask->vm);
-  if( ret != KERN_SUCCESS )  {
-    DUMP( "Memory leak Cannot free pages from old address space %d" , ret );
-  }
-  vmm_free_all_vma( &CURRENT_THREAD->pTask->vm );
-
-
-  //-- claim up user mode mapping from new vm --//
-  ret = vmm_copy_user_ptes(&CURRENT_THREAD->pTask->vm,&vm_task->vm);
-  if( ret != KERN_SUCCESS )  {
-    DUMP( "Failed copying address space address space %d" , ret );
-    assert(0); //-- kill process --//
-  }
-
-  //- invalidate tlb as we just updated page mapping --//
-  set_cr3((uint32_t)CURRENT_THREAD->pTask->vm.pde_base);
-
-  //-- copy all ranges into new VM                --//
-  //-- .text
-  //-- .rodata
-  //-- .heap
-  //-- .bss
-  //-- .stack
   //-- read the header --//
   if( ELF_SUCCESS != elf_load_helper(&se_hdr,fname) ) {
-    DUMP(" Strangely elf_load_helper failed %s", fname);
-    assert(0);
+    DUMP(" elf_load_helper failed %s", fname);
     return KERN_NOT_AN_ELF;
   }
 
-  
-  ret = getbytes(fname,
-		 se_hdr.e_txtoff,
-		 se_hdr.e_txtlen,
-		 (char *)se_hdr.e_txtstart);
-  if(ret != se_hdr.e_txtlen) {
-    DUMP(" getbytes text failed %s", fname);
-    assert(0);
-    ret = KERN_NOT_AN_ELF;
-    goto err;
-  }
+  image = loader_find_image(fname);
+  if( !image )
+    return KERN_ERROR_FILE_NOT_FOUND;
 
-  ret = getbytes(fname,
-		 se_hdr.e_datoff,
-		 se_hdr.e_datlen,
-		 (char *)se_hdr.e_datstart);
-  if(ret != se_hdr.e_datlen) {
-    DUMP(" getbytes data failed %s", fname);
-    assert(0);
-    ret = KERN_NOT_AN_ELF;
-    goto err;
-  }
-  memset((char *)se_hdr.e_datstart + se_hdr.e_datlen,
-	 0,
-	 se_hdr.e_bsslen);
-
-
-  ret = getbytes(fname,
-		 se_hdr.e_rodatoff,
-		 se_hdr.e_rodatlen,
-		 (char *)se_hdr.e_rodatstart);
-  if(ret != se_hdr.e_rodatlen) {
-    DUMP(" getbytes rodata failed %s", fname);
-    assert(0);
-    ret = KERN_NOT_AN_ELF;
-    goto err;
+  vmm_exec_stage_init(stage);
+  ret = loader_stage_ranges(stage,layout,&se_hdr,image,arg_bytes);
+  if( KERN_SUCCESS != ret ) {
+    vmm_exec_stage_abort(stage);
+    return ret;
   }
 
-
-  // Mark regions readonly //
-  memset(&attr,0,sizeof(attr));
-  attr.PRESENT      = 1;
-  attr.RW           = 0;
-  attr.US           = 1;
-  attr.GLOBAL       = 0;
-  //. text
-  vm_range.start  = se_hdr.e_txtstart;
-  vm_range.len    = se_hdr.e_txtlen;
-  vmm_set_range_attr( &CURRENT_THREAD->pTask->vm , &vm_range , attr );
-  //. rodata  
-  vm_range.start  = se_hdr.e_rodatstart;
-  vm_range.len    = se_hdr.e_rodatlen;
-  vmm_set_range_attr( &CURRENT_THREAD->pTask->vm , &vm_range , attr );
-
-  //- copy over all ranges from one task to other -//
-  ret = vmm_copy_vmranges_struct(&CURRENT_THREAD->pTask->vm,
-			   &vm_task->vm);
-  if(ret != KERN_SUCCESS) {
-    DUMP(" PRETTY LOW ON MEMORY WILL MESS UP SOON !!");
-    goto err;
-  }
-  
-  
-  //-- free all VMA's 
-  //-- and kernel stack we have claimed its PTE's and page backings -//
-  vmm_free_all_vma(&vm_task->vm);
-  sfree(vm_task->vm.taskmem,
-	vm_task->vm.totalTaskAllocation);
-  
   *start_address = se_hdr.e_entry;
-  *u_stack       = vm_task->vm.vm_stack_start + vm_task->vm.vm_stack_len;
   return KERN_SUCCESS;
-  
- err: 
-  vmm_unback_all_user_ranges( &vm_task->vm );
-  vmm_free_user_ptes( &vm_task->vm );
-
-  vmm_free_all_vma( &vm_task->vm );
-  sfree(vm_task->vm.taskmem,
-	vm_task->vm.totalTaskAllocation);
-  return ret;
 }
 
+/** @function  load_elf_commit
+ *  @brief     This function replaces the user address space of the task
+ *             with a staged one. Cannot fail
+ *
+ *  @param     task - pointer to task; need not be the running one
+ *  @param     stage - staged user space from load_elf_stage
+ *  @param     layout - the vm_*_start/len from load_elf_stage
+ *  @param     u_stack - userland stack start address 
+ *
+ *  @return    void
+ */
+
+void load_elf_commit(ktask          *task ,
+		     vmm_exec_stage *stage ,
+		     task_vm        *layout ,
+		     unsigned long  *u_stack
+		     )
+{
+  vmm_exec_commit(&task->vm,stage);
+  task->vm.vm_text_start  = layout->vm_text_start;
+  task->vm.vm_text_len    = layout->vm_text_len;
+  task->vm.vm_rdata_start = layout->vm_rdata_start;
+  task->vm.vm_rdata_len   = layout->vm_rdata_len;
+  task->vm.vm_data_start  = layout->vm_data_start;
+  task->vm.vm_data_len    = layout->vm_data_len;
+  task->vm.vm_stack_start = layout->vm_stack_start;
+  task->vm.vm_stack_len   = layout->vm_stack_len;
+
+  *u_stack = task->vm.vm_stack_start + task->vm.vm_stack_len;
+}
 
+/** @function  load_elf
+ *  @brief     This function replaces the user address space of the task
+ *             with the elf file sections. Everything that can fail is
+ *             staged first, so on failure the task still has its old
+ *             address space and gets the error back
+ *
+ *  @param     task - pointer to task
+ *  @param     fname - name of the file in the ramdisk that must be loaded
+ *  @param     arg_bytes - stack the arguments will take
+ *  @param     start_address - start address of the binary loaded in text section
+ *  @param     u_stack - userland stack start address 
+ *
+ *  @return    KERN_SUCCESS on success 
+ *             Else an appropriate error code on failure
+ */
+
+KERN_RET_CODE load_elf(ktask         *task , 
+		       char          *fname ,
+		       unsigned long  arg_bytes ,
+		       unsigned long *start_address,
+		       unsigned long *u_stack
+		       )
+{
+  KERN_RET_CODE  ret;
+  vmm_exec_stage stage;
+  task_vm        layout;
+
+  //-- stage the new user space; the old one is still intact --//
+  ret = load_elf_stage(fname,arg_bytes,&stage,&layout,start_address);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  //-- point of no return; swap the user half of the address space --//
+  //-- no copying; the sections are paged in from the image        --//
+  load_elf_commit(task,&stage,&layout,u_stack);
+  return KERN_SUCCESS;
+}
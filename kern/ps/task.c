@@ -34,6 +34,10 @@ ktask *init_task;        //- first User mode task. Initial binary image
                          //- is hand crafted to do an exec system call 
                          //- with a specified file name 
 
+//- every thread that has not vanished; a tid is only dereferenced -//
+//- once found here, since the stacks of vanished threads are freed -//
+task_kthread_head live_threads;
+
 extern char sc_ret_from_syscall;
 
 /** @function  PAGING_ENABLE
@@ -45,8 +49,14 @@ extern char sc_ret_from_syscall;
 void PAGING_ENABLE() {
     uint32_t cr0;	
 			
+    //-- 4MB pages for the direct map and big new_pages regions --//
+    set_cr4(get_cr4() | CR4_PSE);
+
     cr0 = get_cr0();	
     cr0 |= CR0_PG;	
+    //-- kernel writes to read only user pages fault too, so copies to --//
+    //-- user memory break copy on write like user writes do --//
+    cr0 |= CR0_WP;	
     set_cr0(cr0);	
 			
     DUMP("Paging enabled");
@@ -75,6 +85,54 @@ kthread * get_idle_thread() {
   return &idle_task->initial_thread;
 }
 
+/** @function  thread_register
+ *  @brief     This function puts a new thread on the live thread list
+ *  @param     thread - thread that tids may now name
+ *  @return    void
+ */
+
+void thread_register(kthread *thread) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  Q_INIT_ELEM( thread , kthread_live );
+  Q_INSERT_FRONT( &live_threads , thread , kthread_live );
+  enable_preemption(eflags);
+}
+
+/** @function  thread_unregister
+ *  @brief     This function takes a vanishing thread off the live thread
+ *             list; it has to be off before its stack can be freed
+ *  @param     thread - thread leaving its task's thread list
+ *  @return    void
+ */
+
+void thread_unregister(kthread *thread) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  Q_REMOVE( &live_threads , thread , kthread_live );
+  enable_preemption(eflags);
+}
+
+/** @function  thread_lookup
+ *  @brief     This function finds the live thread a tid names without
+ *             dereferencing the tid
+ *  @param     tid - thread id handed to user mode
+ *  @note      called with preemption disabled; the thread may vanish as
+ *             soon as it is enabled again
+ *  @return    the thread; NULL if no live thread has that tid
+ */
+
+kthread * thread_lookup(int tid) {
+  kthread *thread;
+
+  Q_FOREACH( thread , &live_threads , kthread_live )
+    if( thread == (kthread *)tid )
+      return thread;
+  return NULL;
+}
+
 // -- function prototype (defined below) -- //
 KERN_RET_CODE setup_init_code( ktask *init_task );
 
@@ -226,6 +284,7 @@ KERN_RET_CODE task_run_idle_loop(ktask *idle_task) {
   //-- Enable paging --//
   set_cr3((uint32_t)idle_task->vm.pde_base);
   PAGING_ENABLE();
+  vmm_tlb_enable_global();
 
   ret = timer_set_callback(scheduler_timer_callback);
   if( KERN_SUCCESS != ret ) { 
@@ -249,6 +308,13 @@ KERN_RET_CODE task_run_idle_loop(ktask *idle_task) {
     if(retard++ == 100000) {
       DUMP("Idle thread:");
     }
+    //-- spare cycles go to clearing frames ahead of page faults --//
+    //-- to merging frames that hold the same bytes and to       --//
+    //-- freeing the stacks of vanished threads                  --//
+    vmm_zero_pool_refill(VMM_ZERO_POOL_BATCH);
+    vmm_ksm_scan(VMM_KSM_BATCH);
+    vmm_kstack_reap();
+
     //-- idle is always runnable --//
     schedule(CURRENT_RUNNABLE);
   }
@@ -295,8 +361,8 @@ KERN_RET_CODE task_setup_init_code(
 
 
   //-- Allocate an user mode PTE page -//
-  new_pte = smemalign( PAGE_SIZE , PAGE_SIZE );
-  memset( new_pte , 0 , PAGE_SIZE );
+  new_pte = vmm_alloc_pte_page();
+  assert(new_pte);
   
   //-- Allocate a page for init user mode code --//
   ret = vmm_get_free_user_pages(&user_mode_pfn);
@@ -324,6 +390,12 @@ KERN_RET_CODE task_setup_init_code(
   pde_base[i].GLOBAL         = 0;
   pde_base[i].ADDRESS        = (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
 
+  //-- exec tears these down like any other user mapping --//
+  ret = vmm_rmap_add(PTE_PAGE_PFN(new_pte),&init_task->vm,i * LARGE_PAGE_SIZE,NULL);
+  assert(ret == KERN_SUCCESS);
+  ret = vmm_rmap_add(user_mode_pfn,NULL,0,&new_pte[0]);
+  assert(ret == KERN_SUCCESS);
+
   //-- init task user mode code setup --//
   //-- init process has on 1 user mode page (0^) --//
   /*
@@ -403,6 +475,7 @@ KERN_RET_CODE task_init(char *initial_binary) {
   int ret;
   FN_ENTRY();
 
+  Q_INIT_HEAD( &live_threads );
 
   //- Create the idle task -//
   ret = vmm_init_task_vm( NULL, &idle_task );
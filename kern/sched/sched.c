@@ -91,6 +91,9 @@ static inline void context_switch(
 				  kthread *old_thread,
 				  kthread *new_thread)
 {
+  if( old_thread->pTask != new_thread->pTask )
+    vmm_tlb_count_switch();
+
   //- for consistency save restore format same as syscall_enter --//
 
   //- only instead of syscall code esp is pushed                --//
@@ -240,6 +243,10 @@ void scheduler_timer_callback(unsigned int jiffies) {
   //DEBUG_PRINT("scheduler_timer_callback calling schedule");
   //- schedule isCurrentRunnable=1 is equivalent of yield -//
 
+  //- the running task's accessed bits feed its working set estimate -//
+  if( !is_idle_thread() )
+    vmm_wss_tick( &(CURRENT_THREAD)->pTask->vm );
+
   //- Uncomment this if block to have variable time slice
   if(timeslice++ % TIME_QUANTUM == 0) {
     schedule(CURRENT_RUNNABLE);
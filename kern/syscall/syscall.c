@@ -46,17 +46,10 @@ typedef struct _SYS_CALL {
 KERN_RET_CODE syscall_unimpl(void *user_param_packet);
 
 
-/** @macro    TOTAL_SYSTEM_CALLS
- *  @brief    total system calls supported by the kernel
- */
-
-#define TOTAL_SYSTEM_CALLS (CAS2I_RUNFLAG_INT - SYSCALL_INT + 1)
-
-
 /** @global   sys_call_table
  *  @brief    dispatch table for system calls
  */
-SYS_CALL sys_call_table[TOTAL_SYSTEM_CALLS] =
+SYS_CALL sys_call_table[] =
   {
     { SYSCALL_INT         , syscall_unimpl,       0 , syscall_unimpl },
     { FORK_INT            , syscall_fork,         0 , syscall_noargs_check},
@@ -82,10 +75,28 @@ SYS_CALL sys_call_table[TOTAL_SYSTEM_CALLS] =
     { TASK_VANISH_INT     , syscall_taskvanish,   0 , syscall_noargs_check},
     { SET_STATUS_INT      , syscall_set_status,   0 , syscall_singleargs_check},
     { VANISH_INT          , syscall_vanish,       0 , syscall_noargs_check},
-    { CAS2I_RUNFLAG_INT   , syscall_cas2irunflag, 0 , syscall_cas2i_check}
+    { CAS2I_RUNFLAG_INT   , syscall_cas2irunflag, 0 , syscall_cas2i_check},
+
+    //-- extensions in the reserved syscall range --//
+    { MEMSTATS_INT        , syscall_memstats,     0 , syscall_memstats_check},
+    { SPAWN_INT           , syscall_spawn,        0 , syscall_exec_check},
+    { FRAME_MAPPINGS_INT  , syscall_frame_mappings, 0 , syscall_frame_mappings_check},
+    { WSS_STATS_INT       , syscall_wss_stats,    0 , syscall_wss_stats_check},
+    { MADVISE_INT         , syscall_madvise,      0 , syscall_madvise_check},
+    { SHM_CREATE_INT      , syscall_shm_create,   0 , syscall_shm_create_check},
+    { SHM_ATTACH_INT      , syscall_shm_attach,   0 , syscall_shm_attach_check},
+    { SHM_DETACH_INT      , syscall_shm_detach,   0 , syscall_shm_detach_check}
   };
 
 
+/** @macro    TOTAL_SYSTEM_CALLS
+ *  @brief    total system calls supported by the kernel
+ *  @note     the interrupt numbers are sparse; count the table instead
+ */
+
+#define TOTAL_SYSTEM_CALLS ((int)(sizeof(sys_call_table) / sizeof(SYS_CALL)))
+
+
 /** @macro   IS_VALID_SYSTEM_CALL_IDX
  *  @brief   bound checking for the sys_call_table
  */
@@ -31,35 +31,39 @@
 KERN_RET_CODE syscall_cas2irunflag(void *user_param_packet) {
   uint32_t     eflags;
   KERN_RET_CODE ret = KERN_SUCCESS;
-  int *oldp, tid, ev1, nv1, ev2, nv2;
+  uint32_t params[6];
+  int *oldp, old, tid, ev1, nv1, ev2, nv2;
   kthread *thisThread = (CURRENT_THREAD);
   kthread *targetThread;
   FN_ENTRY();
 
-  // -- extract the arguments to the call -- //
-  tid = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  oldp = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-  ev1 = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,2);
-  nv1 = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,3);
-  ev2 = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,4);
-  nv2 = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,5);
+  // -- extract the arguments to the call; read once, as they may change -- //
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  tid  = (int)params[0];
+  oldp = (int *)params[1];
+  ev1  = (int)params[2];
+  nv1  = (int)params[3];
+  ev2  = (int)params[4];
+  nv2  = (int)params[5];
 
 
-  // -- verify if the pointer references are correct -- //
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (void *)oldp , sizeof(int) );
-  if( KERN_SUCCESS != ret )
-    return KERN_ERROR_GENERIC;
-
-  targetThread = (kthread *)tid;
-
   // -- lock scheduler (feign atomicity) -- //
   eflags = disable_preemption();
 
-  // -- extract the return value -- //
-  *oldp = targetThread->run_flag;
+  // -- a tid is a pointer that may be freed; never follow it blindly -- //
+  targetThread = thread_lookup(tid);
+  if( NULL == targetThread ) {
+    enable_preemption(eflags);
+    DUMP("Failure: Parameter check failed for cas2i_runflag syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  // -- extract the return value; it goes out once preemption is back -- //
+  old = targetThread->run_flag;
 
   // -- set runflag to nv1 if it was ev1 -- //
-  if( *oldp == ev1 ) {
+  if( old == ev1 ) {
     if( (nv1 < 0)&&( targetThread != thisThread ) ) {
       enable_preemption(eflags);
       return KERN_ERROR_GENERIC;
@@ -68,7 +72,7 @@ KERN_RET_CODE syscall_cas2irunflag(void *user_param_packet) {
   }
 
   // -- set runflag to nv2 if it was ev2 -- //
-  if( *oldp == ev2 ) {
+  if( old == ev2 ) {
     if( (nv2 < 0)&&( targetThread != thisThread ) ) {
       enable_preemption(eflags);
       return KERN_ERROR_GENERIC;
@@ -79,6 +83,10 @@ KERN_RET_CODE syscall_cas2irunflag(void *user_param_packet) {
 
   // -- unlock scheduler -- //
   enable_preemption(eflags);
+
+  ret = vmm_copy_to_user(oldp,&old,sizeof(int));
+  if( KERN_SUCCESS != ret )
+    return KERN_ERROR_GENERIC;
   schedule(CURRENT_RUNNABLE);
   
   FN_LEAVE();
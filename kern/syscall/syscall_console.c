@@ -23,6 +23,9 @@
 #include "bootdrvlib/timer_driver.h"
 #include "bootdrvlib/keyb_driver.h"
 
+// -- bytes print copies out of user memory at a time -- //
+#define CONSOLE_PRINT_CHUNK 256
+
 
 /** @function  syscall_getchar
  *  @brief     This function implements the get_char system call
@@ -51,11 +54,21 @@ KERN_RET_CODE syscall_readline(void *user_param_packet) {
   KERN_RET_CODE ret;
   int len;
   char *buf;
+  char line[KEYB_DRIVER_LINE_MAX];
   FN_ENTRY();
   len  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
   buf  = *(char **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);  
-  memset(buf,0,len);
-  ret = synchronous_readline(len,buf);
+  if( len < 0 )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  // -- no line is longer than the key buffer; read it here first -- //
+  if( len > KEYB_DRIVER_LINE_MAX )
+    len = KEYB_DRIVER_LINE_MAX;
+  memset(line,0,len);
+  ret = synchronous_readline(len,line);
+
+  if( KERN_SUCCESS != vmm_copy_to_user(buf,line,len) )
+    return KERN_ERR_BAD_SYS_PARAM;
   FN_LEAVE();
   return ret;
 }
@@ -69,13 +82,21 @@ KERN_RET_CODE syscall_readline(void *user_param_packet) {
 
 KERN_RET_CODE syscall_print(void *user_param_packet) {
   int           len;
+  int           n;
   char         *buf;
+  char          chunk[CONSOLE_PRINT_CHUNK];
   FN_ENTRY();
 
   len  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
   buf  = *(char **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
 
-  putbytes(buf,len);
+  // -- copied out a chunk at a time; putbytes may not fault -- //
+  for( ; len > 0 ; len -= n , buf += n ) {
+    n = ( len < CONSOLE_PRINT_CHUNK ) ? len : CONSOLE_PRINT_CHUNK;
+    if( KERN_SUCCESS != vmm_copy_from_user(chunk,buf,n) )
+      return KERN_ERR_BAD_SYS_PARAM;
+    putbytes(chunk,n);
+  }
   FN_LEAVE();
   return KERN_SUCCESS;
 }
@@ -126,11 +147,16 @@ KERN_RET_CODE syscall_setcursorpos(void *user_param_packet) {
 
 KERN_RET_CODE syscall_getcursorpos(void *user_param_packet) {
   int *rowp,*colp;
+  int row,col;
   FN_ENTRY();
 
   rowp  = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
   colp  = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-  get_cursor(rowp,colp);
+  get_cursor(&row,&col);
+
+  if( KERN_SUCCESS != vmm_copy_to_user(rowp,&row,sizeof(int)) ||
+      KERN_SUCCESS != vmm_copy_to_user(colp,&col,sizeof(int)) )
+    return KERN_ERR_BAD_SYS_PARAM;
 
   FN_LEAVE();
   return KERN_SUCCESS;
@@ -22,16 +22,7 @@
 #include "i386lib/i386systemregs.h"
 
 
-#define GET_ARG_PTR(pppc,idx) *(((*pppc))+(idx)) 
-
-struct  _exec_args {
-  int argc;
-  int data_len;
-  char *filename;
-  char *argv[0];
-}PACKED;
-typedef struct _exec_args exec_args;
-
+extern kern_vmm kernel_vmm;
 
 // -- Below 2 functions are used because of the way our loader is implemented -- //
 // -- Our loader goes on to spawn a new task and loads the file there -- //
@@ -105,6 +96,20 @@ void exec_copy_argv_to_stack(char *stack,
 }
 
 
+/** @function  exec_free_args
+ *  @brief     This function frees the arguments copied by exec_copy_argv
+ *  @param     exec_args - the copied arguments
+ *  @return    void
+ */
+
+void exec_free_args(struct _exec_args *exec_args) {
+  if( EXEC_ARGS_SIZE(exec_args->argc,exec_args->data_len) <= VMM_EXEC_ARGS_BYTES )
+    vmm_cache_free(&kernel_vmm.exec_args_cache,exec_args);
+  else
+    free(exec_args);
+}
+
+
 /** @function  exec_copy_argv
  *  @brief     This function copies the argument string
  *  @param     user_param_packet - %esi as passed down from user mode
@@ -116,70 +121,100 @@ KERN_RET_CODE exec_copy_argv(void *user_param_packet,
 			     exec_args **exec_args)
 {
   struct _exec_args *local_exec_args=NULL; 
-  char     **filename=NULL;
-  char    ***argv=NULL;
+  char      *params[2];
+  char      *filename=NULL;
+  char     **argv=NULL;
+  char      *arg;
   char      *data=NULL;
+  char      *end;
   int        data_len=0;
   int        argc=0;
+  int        size;
+  int        len;
   int        i;
 
   //-- get out the two parameters --//
-  filename = (char **)user_param_packet; 
-  argv = (char ***)((char *)user_param_packet + sizeof(STACK_ELT));
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  filename = params[0];
+  argv = (char **)params[1];
 
   if(!filename || !argv) {
     DUMP("NULL parameters to sys_exec");
     return KERN_ERROR_GENERIC; 
   }
   
-  for(argc=0 ; 
-      GET_ARG_PTR(argv,argc) && GET_ARG_PTR(argv,argc)[0] != '\0' ; 
-      argc++) 
-  { 
-    data_len += strlen(GET_ARG_PTR(argv,argc)) + 1;
+  //-- argv ends at a NULL or an empty string --//
+  for(argc=0 ; ; argc++) {
+    if( KERN_SUCCESS != vmm_copy_from_user(&arg,&argv[argc],sizeof(arg)) )
+      return KERN_ERR_BAD_SYS_PARAM;
+    if( !arg )
+      break;
+    len = vmm_strnlen_user(arg,EXEC_ARG_MAX_BYTES);
+    if( len < 0 || EXEC_ARG_MAX_BYTES == len )
+      return KERN_ERR_BAD_SYS_PARAM;
+    if( 0 == len )
+      break;
+    data_len += len + 1;
   } 
   data_len++;
   // argc++; //6 for foo a b c d [NULL]
   // argc now contains elements in argv array +
-  data_len += strlen(*filename) + 1;
-
-  local_exec_args = malloc(sizeof(*local_exec_args) + 
-			   (sizeof(char *) * argc)+
-			   data_len);
-  memset(local_exec_args,0,sizeof(*local_exec_args) + 
-			   (sizeof(char *) * argc)+data_len);
+  len = vmm_strnlen_user(filename,EXEC_ARG_MAX_BYTES);
+  if( len < 0 || EXEC_ARG_MAX_BYTES == len )
+    return KERN_ERR_BAD_SYS_PARAM;
+  data_len += len + 1;
+
+  //-- no fault may be taken while they are written to the new stack --//
+  if( EXEC_ARGS_STACK_BYTES(argc,data_len) > EXEC_ARGS_MAX_STACK )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  //-- the common small case comes from the exec_args cache --//
+  size = EXEC_ARGS_SIZE(argc,data_len);
+  if( size <= VMM_EXEC_ARGS_BYTES )
+    local_exec_args = vmm_cache_alloc(&kernel_vmm.exec_args_cache);
+  else
+    local_exec_args = malloc(size);
 
   if(!local_exec_args)
     return KERN_NO_MEM; 
+  memset(local_exec_args,0,size);
 
   local_exec_args->argc = argc;
   local_exec_args->data_len = data_len;
   data = (char *) (&local_exec_args->argv[argc]);
-
-  // copy stuff over //
-  for(i=0;i<argc;i++) {
-    memcpy(data,
-	   GET_ARG_PTR(argv,i),
-	   strlen(GET_ARG_PTR(argv,i))
-	   );
-    local_exec_args->argv[i] = data;
-    data =  data + strlen(GET_ARG_PTR(argv,i)) + 1;
+  end  = (char *)local_exec_args + size;
+
+  // copy stuff over; the filename goes last //
+  // another thread may have changed the strings since they were sized //
+  for(i=0;i<=argc;i++) {
+    if( i < argc ) {
+      if( KERN_SUCCESS != vmm_copy_from_user(&arg,&argv[i],sizeof(arg)) || !arg )
+	goto copy_failed;
+      local_exec_args->argv[i] = data;
+    }
+    else {
+      arg = filename;
+      local_exec_args->filename = data;
+    }
+
+    len = vmm_strncpy_from_user(data,arg,end - data);
+    if( len < 0 || len == end - data )
+      goto copy_failed;
+    data = data + len + 1;
   }
-    
-  local_exec_args->filename = data;
-  memcpy(local_exec_args->filename,*filename,strlen(*filename));
-  data =  data + strlen(*filename) + 1;
 
 
   //-- We cannot live with silent corruptions -//
-  assert(data <= (char *)local_exec_args + 
-	 sizeof(*local_exec_args) + 
-	 sizeof(char *) * argc +
-	 data_len);
+  assert(data <= end);
   
 
   *exec_args=local_exec_args;
   return KERN_SUCCESS;
+
+ copy_failed:
+  exec_free_args(local_exec_args);
+  return KERN_ERR_BAD_SYS_PARAM;
 }
 
 
@@ -211,16 +246,21 @@ KERN_RET_CODE syscall_exec(void *user_param_packet) {
   //-- load the filename --//
   ret =  load_elf(CURRENT_THREAD->pTask,
 		  local_exec_args->filename,
+		  EXEC_ARGS_STACK_BYTES(local_exec_args->argc,
+					local_exec_args->data_len),
 		  &start_address,
 		  &u_stack);
 
   if(ret != KERN_SUCCESS) { 
     DUMP("load_elf failed kill process");
-    free(local_exec_args);
+    exec_free_args(local_exec_args);
     task_fork_unlock(CURRENT_THREAD->pTask);    
     return ret;
   }
 
+  //-- the new pages and segments charged to the quota are gone --//
+  CURRENT_THREAD->pTask->allocated_pages_mem = 0;
+
   //-- Setup the argv stack --//
   exec_copy_argv_to_stack((char  *)  u_stack,
 			  (char **) &new_u_stack,
@@ -232,7 +272,7 @@ KERN_RET_CODE syscall_exec(void *user_param_packet) {
 			  (STACK_ELT)  start_address,
 			  (STACK_ELT)  0
 			  ); 
-  free(local_exec_args);
+  exec_free_args(local_exec_args);
 
   task_fork_unlock(CURRENT_THREAD->pTask);    
   FN_LEAVE();
@@ -74,15 +74,6 @@ KERN_RET_CODE syscall_fork(void *user_param_packet) {
   ktask           *thisTask = (CURRENT_THREAD)->pTask;
   ktask           *newTask;
   kthread         *newThread;
-  vm_range        *vmrange_ptr;
-  PDE             attributes;
-
-
-  attributes.PRESENT        = 1;
-  attributes.RW             = 0;
-  attributes.US             = 1;
-  attributes.GLOBAL         = 0;
-
 
 
   // -- intialize the new task -- //
@@ -95,40 +86,29 @@ KERN_RET_CODE syscall_fork(void *user_param_packet) {
   }
   newThread = &newTask->initial_thread;
 
-  // Install ranges in newTask //
-  Q_FOREACH( vmrange_ptr , &(thisTask->vm).vm_ranges_head , vm_range_next ) {
-
-  // -- Skip the element with start < USER_MEM_START as -- //
-  // -- it is the kernel range which need not be copied -- //
-  // -- onto the new task as it has its own copy -- //
-    if( vmrange_ptr == &thisTask->vm.vm_range_kernel )
-      continue;
-
-    ret = vmm_install_range( &newTask->vm, vmrange_ptr );
-    if( ret != KERN_SUCCESS )  {
-      DUMP( "new task install range failed %d" , ret );
-      task_fork_unlock(thisTask);    
-      return ret;  
-    }
-
-    //- Make the child share the physical pages with parent --//
-    ret = vmm_share_physical_range(&newTask->vm,
-				   &thisTask->vm,
-				   vmrange_ptr);
-    if( ret != KERN_SUCCESS )  {
-      DUMP( "cannot share pages between parent and child", ret );
-      task_fork_unlock(thisTask);    
-      return ret;  
-    }
-    
-    //- Mark range Readonly in parent task -//
-    vmm_set_range_attr( &thisTask->vm, vmrange_ptr , attributes);
-    //- Mark range Readonly in child task -//
-    vmm_set_range_attr( &newTask->vm, vmrange_ptr , attributes);
+  // Copy the range book keeping into newTask //
+  ret = vmm_copy_vmranges_struct( &newTask->vm , &thisTask->vm );
+  if( ret != KERN_SUCCESS )  {
+    DUMP( "new task copy ranges failed %d" , ret );
+    task_fork_unlock(thisTask);    
+    return ret;  
+  }
+
+  //- the child has the same new pages and segments to give back -//
+  newTask->allocated_pages_mem = thisTask->allocated_pages_mem;
+
+  //- Make the child share the page tables with parent    --//
+  //- page tables are write protected at the PDE in both  --//
+  //- and copied on the first fault that has to edit them --//
+  ret = vmm_share_user_ptes( &newTask->vm , &thisTask->vm );
+  if( ret != KERN_SUCCESS )  {
+    DUMP( "cannot share page tables between parent and child", ret );
+    task_fork_unlock(thisTask);    
+    return ret;  
   }
 
   // Invalidate parents TLB //
-  set_cr3((uint32_t)CURRENT_THREAD->pTask->vm.pde_base);
+  vmm_tlb_flush_all(&CURRENT_THREAD->pTask->vm);
   thread_setup_ret_from_fork(newThread);
   scheduler_add( newThread );
   FN_LEAVE();
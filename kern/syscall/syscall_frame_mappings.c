@@ -0,0 +1,84 @@
+/** @file     syscall_frame_mappings.c
+ *  @brief    This file contains the system call handler for frame_mappings()
+ *
+ *            frame_mappings() answers "who maps frame N" from the reverse
+ *            mappings kept by the VMM; it is meant for looking into memory
+ *            pressure, together with memstats().
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  syscall_frame_mappings
+ *  @brief     This function implements the frame_mappings system call
+ *             it fills in the tasks and addresses mapping a user frame
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    number of mappings, which may be more than were filled in;
+ *             KERN_ERR_BAD_SYS_PARAM if pfn is not a user frame, count
+ *             is out of bounds or buf cannot be written; KERN_NO_MEM
+ *             when out of memory
+ */
+
+KERN_RET_CODE syscall_frame_mappings(void *user_param_packet) {
+  uint32_t        params[3];
+  int             pfn;
+  rmap_mapping_t *buf;
+  rmap_mapping_t *mappings = NULL;
+  int             count;
+  int             nr;
+  KERN_RET_CODE   ret;
+  FN_ENTRY();
+
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  pfn   = (int)params[0];
+  buf   = (rmap_mapping_t *)params[1];
+  count = (int)params[2];
+
+  if( pfn < USER_FIRST_PFN || pfn >= kernel_vmm.nr_physical_pages ||
+      count < 0 || count > RMAP_QUERY_MAX ) {
+    DUMP("Failure: Parameter check failed for frame_mappings syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  //-- the walk runs with preemption off; gather into the kernel first --//
+  if( count ) {
+    mappings = malloc(count * sizeof(rmap_mapping_t));
+    if( NULL == mappings )
+      return KERN_NO_MEM;
+  }
+
+  nr = vmm_rmap_query(pfn,mappings,count);
+
+  //-- the user buffer may fault; it is written once preemption is back --//
+  ret = KERN_SUCCESS;
+  if( count )
+    ret = vmm_copy_to_user(buf,mappings,
+			   ( nr < count ? nr : count ) * sizeof(rmap_mapping_t));
+  free(mappings);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  FN_LEAVE();
+  return nr;
+}
@@ -13,6 +13,30 @@
 #define GET_NTH_PARAM_FROM_PACKET(user_param_packet,n)	\
   ((char *)(   (char *)(user_param_packet) + sizeof(uint32_t) *(n) ))
 
+// -- kernel copy of the filename and argv of exec/spawn -- //
+struct  _exec_args {
+  int argc;
+  int data_len;
+  char *filename;
+  char *argv[0];
+}PACKED;
+typedef struct _exec_args exec_args;
+
+//-- longest argument or filename exec copies in, its NUL included --//
+#define EXEC_ARG_MAX_BYTES (16 * PAGE_SIZE)
+
+//-- bytes taken by an exec_args holding argc strings of data_len bytes --//
+#define EXEC_ARGS_SIZE(argc,data_len) \
+  (sizeof(struct _exec_args) + sizeof(char *) * (argc) + (data_len))
+
+//-- user stack exec_copy_argv_to_stack writes for them: the strings,  --//
+//-- alignment, argv[], argv, argc and the return address             --//
+#define EXEC_ARGS_STACK_BYTES(argc,data_len) \
+  ((data_len) + 3 + sizeof(STACK_ELT) * ((argc) + 4))
+
+//-- they have to fit in the stack pages backed before the program runs --//
+#define EXEC_ARGS_MAX_STACK (VMM_EXEC_STAGE_PAGES * PAGE_SIZE)
+
 
 KERN_RET_CODE syscall_exec(void *user_param_packet); 
 KERN_RET_CODE syscall_gettid(void *user_param_packet);
@@ -43,10 +67,21 @@ KERN_RET_CODE syscall_halt(void *user_param_packet);
 KERN_RET_CODE syscall_newpages(void *user_param_packet);
 KERN_RET_CODE syscall_removepages(void *user_param_packet);
 KERN_RET_CODE syscall_cas2irunflag(void *user_param_packet);
+KERN_RET_CODE syscall_memstats(void *user_param_packet);
+KERN_RET_CODE syscall_spawn(void *user_param_packet);
+KERN_RET_CODE syscall_frame_mappings(void *user_param_packet);
+KERN_RET_CODE syscall_wss_stats(void *user_param_packet);
+KERN_RET_CODE syscall_madvise(void *user_param_packet);
+KERN_RET_CODE syscall_shm_create(void *user_param_packet);
+KERN_RET_CODE syscall_shm_attach(void *user_param_packet);
+KERN_RET_CODE syscall_shm_detach(void *user_param_packet);
 
 
 /*Exported Function Prototypes*/
 void thread_setup_ret_from_fork(kthread *thread) ;
+KERN_RET_CODE exec_copy_argv(void *user_param_packet,exec_args **exec_args);
+void exec_copy_argv_to_stack(char *stack,char **newStack,exec_args *exec_args);
+void exec_free_args(exec_args *exec_args);
 
 // -- Checker function prototypes -- //
 KERN_RET_CODE syscall_noargs_check(void *user_param_packet);
@@ -63,5 +98,12 @@ KERN_RET_CODE syscall_exec_check(void *user_param_packet);
 KERN_RET_CODE syscall_ls_check(void *user_param_packet);
 KERN_RET_CODE syscall_wait_check(void *user_param_packet);
 KERN_RET_CODE syscall_yield_check(void *user_param_packet);
+KERN_RET_CODE syscall_memstats_check(void *user_param_packet);
+KERN_RET_CODE syscall_frame_mappings_check(void *user_param_packet);
+KERN_RET_CODE syscall_wss_stats_check(void *user_param_packet);
+KERN_RET_CODE syscall_madvise_check(void *user_param_packet);
+KERN_RET_CODE syscall_shm_create_check(void *user_param_packet);
+KERN_RET_CODE syscall_shm_attach_check(void *user_param_packet);
+KERN_RET_CODE syscall_shm_detach_check(void *user_param_packet);
 
 #endif // _SYS_CALL_INTRNL_H
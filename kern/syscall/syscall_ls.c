@@ -29,10 +29,13 @@
 /** @function  syscall_ls
  *  @brief     This function implements the ls system call
  *  @param     user_param_packet - %esi as passed down from user mode
- *  @return    number of files in system on success; KERN err code on failure
+ *  @return    number of files in system on success; KERN_BUFFER_TOO_SMALL
+ *             if they do not fit; KERN_ERR_BAD_SYS_PARAM if buf cannot
+ *             be written
  */
 
 KERN_RET_CODE syscall_ls(void *user_param_packet) {
+  static const char zeros[64];
   int index;
   int n;
   int names_len;
@@ -57,16 +60,26 @@ KERN_RET_CODE syscall_ls(void *user_param_packet) {
     return KERN_BUFFER_TOO_SMALL;
   }
 
-  //- copy over filename -//
-  memset(buf , 0 , len);
+  //- copy over filename along with its NUL -//
   index = 0;
   while(index < exec2obj_userapp_count) {
-    n = strlen(exec2obj_userapp_TOC[index].execname);
-    memcpy(buf,exec2obj_userapp_TOC[index].execname,n);
-    buf += (n+1);
+    n = strlen(exec2obj_userapp_TOC[index].execname) + 1;
+    if( KERN_SUCCESS != vmm_copy_to_user(buf,exec2obj_userapp_TOC[index].execname,n) )
+      return KERN_ERR_BAD_SYS_PARAM;
+    buf += n;
+    len -= n;
     index++;
   }
 
+  //- the rest of the buffer reads as zero -//
+  while(len > 0) {
+    n = len < (int)sizeof(zeros) ? len : (int)sizeof(zeros);
+    if( KERN_SUCCESS != vmm_copy_to_user(buf,zeros,n) )
+      return KERN_ERR_BAD_SYS_PARAM;
+    buf += n;
+    len -= n;
+  }
+
   FN_LEAVE();
   return index;
 }
@@ -0,0 +1,98 @@
+/** @file     syscall_madvise.c
+ *  @brief    This file contains the system call handler for madvise()
+ *
+ *            madvise() tells the kernel how a task is going to use part
+ *            of one of its ranges. An allocator can hand the frames of
+ *            free memory back with MADV_DONTNEED and keep the range,
+ *            instead of a remove_pages()/new_pages() round trip.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include <madvise.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+
+
+/** @function  syscall_madvise
+ *  @brief     This function implements the madvise system call
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM on an
+ *             unaligned span or unknown advice;
+ *             KERN_ERROR_ADDRESS_NOT_PRESENT unless one range holds
+ *             every page given; KERN_NO_MEM if MADV_DONTNEED could not
+ *             split a shared page table or 4MB page
+ */
+
+KERN_RET_CODE syscall_madvise(void *user_param_packet) {
+  uint32_t       params[3];
+  unsigned long  start;
+  unsigned long  len;
+  int            advice;
+  vm_range      *range;
+  struct task_vm *vm = &(CURRENT_THREAD)->pTask->vm;
+  KERN_RET_CODE  ret = KERN_SUCCESS;
+  FN_ENTRY();
+
+  //-- read once; another thread may change the packet meanwhile --//
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  start  = params[0];
+  len    = params[1];
+  advice = (int)params[2];
+
+  //-- page aligned and inside user memory, as for new_pages --//
+  if( start < USER_MEM_START || ( start & PAGE_MASK ) ||
+      (int)len <= 0 || ( len & PAGE_MASK ) || start + len - 1 < start ||
+      advice < MADV_NORMAL || advice > MADV_DONTNEED ) {
+    DUMP("Failure: Parameter check failed for madvise syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  //-- last bytes rather than ends; the span asked for may --//
+  //-- end at 4GB, where its end would wrap to 0           --//
+  range = vmm_range_tree_lookup(vm,start);
+  if( NULL == range ||
+      start + len - 1 > range->start + range->len - 1 )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+  switch( advice ) {
+  case MADV_NORMAL:
+    ret = vmm_set_fault_around(range,VMM_FAULT_AROUND_PAGES);
+    break;
+
+  case MADV_RANDOM:
+    ret = vmm_set_fault_around(range,1);
+    break;
+
+  case MADV_SEQUENTIAL:
+    ret = vmm_set_fault_around(range,VMM_FAULT_AROUND_SEQ);
+    break;
+
+  case MADV_WILLNEED:
+    //-- a hint; running short of frames is not an error --//
+    vmm_prefault_range(vm,start,len);
+    break;
+
+  case MADV_DONTNEED:
+    ret = vmm_drop_pages(vm,start,len);
+    break;
+  }
+
+  FN_LEAVE();
+  return ret;
+}
@@ -0,0 +1,46 @@
+/** @file     syscall_memstats.c
+ *  @brief    This file contains the system call handler for memstats()
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+
+
+/** @function  syscall_memstats
+ *  @brief     This function implements the memstats system call
+ *             it copies out a snapshot of the physical frame pool
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM if the
+ *             statistics cannot be written
+ */
+
+KERN_RET_CODE syscall_memstats(void *user_param_packet) {
+  memstats_t stats;
+  memstats_t *user_stats;
+  FN_ENTRY();
+
+  user_stats = (memstats_t *)user_param_packet;
+
+  vmm_get_memstats(&stats);
+  if( KERN_SUCCESS != vmm_copy_to_user(user_stats,&stats,sizeof(stats)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
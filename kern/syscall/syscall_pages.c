@@ -37,7 +37,6 @@
  */
 
 KERN_RET_CODE syscall_newpages(void *user_param_packet) {
-  int i;
   KERN_RET_CODE ret;
   void *base_addr;
   int len;
@@ -71,17 +70,32 @@ KERN_RET_CODE syscall_newpages(void *user_param_packet) {
   if( PAGE_OFFSET( len ))
     return KERN_PAGE_ERR;
 
-  for(i=0;i<len;i+=PAGE_SIZE) {
-    ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , base_addr+i , PAGE_SIZE );
-    if( KERN_SUCCESS == ret )
-      return KERN_PAGE_ERR;
-  }
+  if( len <= 0 || (unsigned long)base_addr + len < (unsigned long)base_addr )
+    return KERN_PAGE_ERR;
+
+  // -- none of the new pages may be part of an existing range -- //
+  if( vmm_get_overlapping_range( &thisTask->vm , base_addr , len ) )
+    return KERN_PAGE_ERR;
 
   // -- setup a vmrange to reflect the new pages to be added -- //
   memset( &vmrange, 0 , sizeof( vmrange ) );
   vmrange.start = ( unsigned long ) base_addr;
   vmrange.len = ( unsigned long ) len;
 
+  // -- 4MB aligned and sized; use 4MB pages if memory allows -- //
+  if( !((unsigned long)base_addr & LARGE_PAGE_MASK) &&
+      !((unsigned long)len & LARGE_PAGE_MASK) ) {
+    ret = vmm_install_large_range( &thisTask->vm , &vmrange );
+    if( ret == KERN_SUCCESS ) {
+      CURRENT_THREAD->pTask->allocated_pages_mem += len;
+      FN_LEAVE();
+      return KERN_SUCCESS;
+    }
+
+    // -- no free 4MB blocks; fall back to demand paged 4K pages -- //
+    vmrange.flags = 0;
+  }
+
 
   // -- install the new pages using the vmm_install_range call -- //
   ret = vmm_install_range( &thisTask->vm , &vmrange );
@@ -91,8 +105,13 @@ KERN_RET_CODE syscall_newpages(void *user_param_packet) {
     return ret;
   }
 
-  // -- initialize the new pages to be read-write at PDE and PTE -- //
-  vmm_set_range_attr( &thisTask->vm, &vmrange , attributes);
+  // -- initialize the new pages to be read-write at PTE -- //
+  ret = vmm_set_range_attr( &thisTask->vm, &vmrange , attributes);
+  if( ret != KERN_SUCCESS )  {
+    vmm_uninstall_range( &thisTask->vm , &vmrange );
+    FN_LEAVE();
+    return ret;
+  }
 
   //- update quota -//
   CURRENT_THREAD->pTask->allocated_pages_mem += len;
@@ -141,6 +160,11 @@ KERN_RET_CODE syscall_removepages(void *user_param_packet) {
   if(vmrange->start != (unsigned long)base_addr) { 
     return KERN_ERROR_ADDRESS_NOT_PRESENT;
   }
+
+  // -- shared memory segments go with shm_detach -- //
+  if(vmrange->shm) {
+    return KERN_PAGE_ERR;
+  }
  
  // -- uninstall the pages using the vmm_uninstall_range call -- //
   CURRENT_THREAD->pTask->allocated_pages_mem -= vmrange->len;
@@ -26,20 +26,21 @@
 /** @function  tid_checker
  *  @brief     This function checks if the tid is a valid tid value or not
  *  @param     tid - thread id of a thread
+ *  @note      the thread may vanish before the handler runs; handlers
+ *             look it up again with thread_lookup before using it
  *  @return    KERN_SUCCESS on success; KERN err code
  */
 
 KERN_RET_CODE tid_checker(int tid) {
-  kthread       *thread;
-  ktask         *pTask;
+  uint32_t      eflags;
   KERN_RET_CODE ret = KERN_ERROR_GENERIC;
   FN_ENTRY();
 
-  pTask = ((kthread *)tid)->pTask;
-
-  Q_FOREACH( thread , &pTask->ktask_threads_head , kthread_next )
-    if( thread == (kthread *)tid )
-      ret = KERN_SUCCESS;
+  // -- a tid is a pointer that may be freed; never follow it blindly -- //
+  eflags = disable_preemption();
+  if( thread_lookup(tid) )
+    ret = KERN_SUCCESS;
+  enable_preemption(eflags);
 
   FN_LEAVE();
   return ret;
@@ -125,22 +126,8 @@ KERN_RET_CODE syscall_settermcolor_check(void *user_param_packet) {
 // -- readline(int len, char *buf) -- //
 
 KERN_RET_CODE syscall_readline_check(void *user_param_packet) {
-  KERN_RET_CODE ret = KERN_SUCCESS;
-  int           len;
-  char          *buf;
-  FN_ENTRY();
-
-  len  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  buf  = *(char **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-
-  // -- Check if the write buffer for given length is in process memory -- //
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (void *)buf , len );
-  if( KERN_SUCCESS != ret ) {
-    DUMP("Failure: Parameter check failed for readline syscall");
-    return KERN_ERROR_INVALID_SYSCALL;
-  }
-  FN_LEAVE();
-  return ret;
+  // -- the handler copies the line out with vmm_copy_to_user -- //
+  return KERN_SUCCESS;
 }
 
 
@@ -154,21 +141,7 @@ KERN_RET_CODE syscall_readline_check(void *user_param_packet) {
 // -- print(int len, char *buf) -- //
 
 KERN_RET_CODE syscall_print_check(void *user_param_packet) {
-  int           len;
-  char          *buf;
-  KERN_RET_CODE ret = KERN_SUCCESS;
-  FN_ENTRY();
-
-  // -- Check if the read buffer for given length is in process memory -- //
-  len  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  buf  = *(char **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (void *)buf , len );
-  if( KERN_SUCCESS != ret ) {
-    DUMP("Failure: Parameter check failed for print syscall");
-    return KERN_ERROR_INVALID_SYSCALL;
-  }
-  FN_LEAVE();
+  // -- the handler copies the buffer in with vmm_copy_from_user -- //
   return KERN_SUCCESS;
 }
 
@@ -198,26 +171,8 @@ KERN_RET_CODE syscall_setcursorpos_check(void *user_param_packet) {
 // -- get_cursor_pos(int *row, int *col) -- //
 
 KERN_RET_CODE syscall_getcursorpos_check(void *user_param_packet) {
-  int           *rowp;
-  int           *colp;
-  KERN_RET_CODE ret = KERN_SUCCESS;
-  FN_ENTRY();
-
-  rowp  = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  colp  = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (char *)rowp , sizeof(int) );
-  if( KERN_SUCCESS != ret ){
-    DUMP("Failure: Parameter check failed for get_cursor_pos syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (char *)colp , sizeof(int) );
-  if( KERN_SUCCESS != ret ){
-    DUMP("Failure: Parameter check failed for get_cursor_pos syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
-  FN_LEAVE();
-  return ret;
+  // -- the handler copies the position out with vmm_copy_to_user -- //
+  return KERN_SUCCESS;
 }
 
 
@@ -231,30 +186,11 @@ KERN_RET_CODE syscall_getcursorpos_check(void *user_param_packet) {
 // -- cas2i_runflag(int tid, int *oldp, int ev1, int nv1, int ev2, int nv2) -- //
 
 KERN_RET_CODE syscall_cas2i_check(void *user_param_packet) {
-  int           tid;
-  int           *oldp;
-  KERN_RET_CODE ret = KERN_SUCCESS;
-  FN_ENTRY();
-
-  tid  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  oldp  = *(int **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (char *)oldp , sizeof(int) );
-  if( KERN_SUCCESS != ret ){
-    DUMP("Failure: Parameter check failed for cas2i_runflag syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
-  ret = tid_checker(tid);
-  if( KERN_SUCCESS != ret ){
-    DUMP("Failure: Parameter check failed for cas2i_runflag syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
-  FN_LEAVE();
-  return ret;
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
 }
 
 
-
 /** @function  syscall_newpages_check
  *  @brief     This function checks if the arguments to newpages are valid
  *  @param     user_param_packet - address of parameter packet - %esi
@@ -332,12 +268,11 @@ KERN_RET_CODE syscall_removepages_check(void *user_param_packet) {
 
 // -- Every call to below call(s) pass through the following function -- //
 // -- exec(char *execname, char *args[]) -- //
+// -- spawn(char *execname, char *args[]) -- //
 
 KERN_RET_CODE syscall_exec_check(void *user_param_packet) {
-
-  // -- The following check for exec parameters will not be required -- //
-  // -- The way exec/loader is implemented, the parameters will be -- //
-  // -- having valid address locations -- //
+  // -- exec_copy_argv copies the filename and argv in with the -- //
+  // -- vmm user copies, which fail on addresses it cannot read  -- //
   return KERN_SUCCESS;
 }
 
@@ -352,19 +287,7 @@ KERN_RET_CODE syscall_exec_check(void *user_param_packet) {
 // -- ls(int size,char *buf) -- //
 
 KERN_RET_CODE syscall_ls_check(void *user_param_packet) {
-  KERN_RET_CODE ret;
-  int len;
-  char *buf;
-
-  FN_ENTRY();
-  len  = *(int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  buf  = *(char **)GET_NTH_PARAM_FROM_PACKET(user_param_packet,1);
-
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , buf , len );
-  if( KERN_SUCCESS != ret ) {
-    DUMP("Failure: Parameter check failed for ls syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
+  // -- the handler copies the names out with vmm_copy_to_user -- //
   return KERN_SUCCESS;
 }
 
@@ -379,16 +302,7 @@ KERN_RET_CODE syscall_ls_check(void *user_param_packet) {
 // -- wait(int *status) -- //
 
 KERN_RET_CODE syscall_wait_check(void *user_param_packet) {
-  int           *status;
-  KERN_RET_CODE ret;
-  FN_ENTRY();
-  status  = (int *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-
-  ret = vmm_is_range_present( &((CURRENT_THREAD)->pTask->vm) , (char *)status , sizeof(int) );
-  if( KERN_SUCCESS != ret ) {
-    DUMP("Failure: Parameter check failed for wait syscall");
-    return KERN_ERR_BAD_SYS_PARAM;
-  }
+  // -- the handler copies the status out with vmm_copy_to_user -- //
   return KERN_SUCCESS;
 }
 
@@ -414,3 +328,119 @@ KERN_RET_CODE syscall_yield_check(void *user_param_packet) {
   ret = tid_checker(tid);
   return ret;
 }
+
+
+/** @function  syscall_memstats_check
+ *  @brief     This function checks if the arguments to memstats are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- memstats(memstats_t *stats) -- //
+
+KERN_RET_CODE syscall_memstats_check(void *user_param_packet) {
+  // -- the handler copies the statistics out with vmm_copy_to_user -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_frame_mappings_check
+ *  @brief     This function checks if the arguments to frame_mappings are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- frame_mappings(int pfn, rmap_mapping_t *buf, int count) -- //
+
+KERN_RET_CODE syscall_frame_mappings_check(void *user_param_packet) {
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_wss_stats_check
+ *  @brief     This function checks if the arguments to wss_stats are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- wss_stats(int tid, wss_stats_t *stats) -- //
+
+KERN_RET_CODE syscall_wss_stats_check(void *user_param_packet) {
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_madvise_check
+ *  @brief     This function checks if the arguments to madvise are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- madvise(void *base_addr, int len, int advice) -- //
+
+KERN_RET_CODE syscall_madvise_check(void *user_param_packet) {
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_shm_create_check
+ *  @brief     This function checks if the arguments to shm_create are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- shm_create(void *base_addr, int len) -- //
+
+KERN_RET_CODE syscall_shm_create_check(void *user_param_packet) {
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_shm_attach_check
+ *  @brief     This function checks if the arguments to shm_attach are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- shm_attach(int shmid, void *base_addr) -- //
+
+KERN_RET_CODE syscall_shm_attach_check(void *user_param_packet) {
+  // -- the handler copies the packet in once and checks the copy -- //
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_shm_detach_check
+ *  @brief     This function checks if the arguments to shm_detach are valid
+ *  @param     user_param_packet - address of parameter packet - %esi
+ *  @return    KERN_SUCCESS on success; KERN err code
+ */
+
+// -- Every call to below call(s) pass through the following function -- //
+// -- shm_detach(void *base_addr) -- //
+
+KERN_RET_CODE syscall_shm_detach_check(void *user_param_packet) {
+  void *base_addr;
+  FN_ENTRY();
+
+  base_addr = (void *)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
+
+  if( base_addr < (void *)USER_MEM_START ||
+      PAGE_OFFSET((unsigned long) base_addr) ) {
+    DUMP("Failure: Parameter check failed for shm_detach syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/** @file     syscall_shm.c
+ *  @brief    This file contains the system call handlers for shm_create(),
+ *            shm_attach() and shm_detach()
+ *
+ *            A shared memory segment lets tasks pass data through the
+ *            same frames instead of copying it through the kernel. One
+ *            task creates a segment and gets its id back; others attach
+ *            it by id, each at an address of its own. A forked child
+ *            inherits the parent's attachments. The segment goes away
+ *            with its last attachment.
+ *
+ *            Segment frames are pinned; swap and page merging leave them
+ *            alone. Every attachment is charged against the task's
+ *            new_pages() quota like a range of new pages, and the charge
+ *            goes with shm_detach() or exec().
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+
+
+/** @function  syscall_shm_create
+ *  @brief     This function implements the shm_create system call
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    id of the new segment, attached at the given address;
+ *             KERN_ERR_BAD_SYS_PARAM on an unaligned address or size;
+ *             KERN_ERROR_GENERIC on a bad size or too many segments;
+ *             KERN_PAGE_ERR if the segment does not fit there;
+ *             KERN_NO_MEM when out of memory or over the quota
+ */
+
+KERN_RET_CODE syscall_shm_create(void *user_param_packet) {
+  uint32_t        params[2];
+  unsigned long   start;
+  int             len;
+  int             id;
+  vmm_shm        *shm;
+  ktask          *thisTask = (CURRENT_THREAD)->pTask;
+  struct task_vm *vm = &thisTask->vm;
+  KERN_RET_CODE   ret;
+  FN_ENTRY();
+
+  //-- read once; the quota is charged with the length checked here --//
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  start = params[0];
+  len   = (int)params[1];
+
+  //-- page aligned and inside user memory, as for new_pages --//
+  if( start < USER_MEM_START || ( start & PAGE_MASK ) ||
+      len <= 0 || ( len & PAGE_MASK ) || start + len <= start ) {
+    DUMP("Failure: Parameter check failed for shm_create syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  //-- pinned frames; charged like new_pages before any is taken --//
+  if( thisTask->allocated_pages_mem + len > (unsigned long)ALLOC_MEM_QUOTA )
+    return KERN_NO_MEM;
+
+  ret = vmm_shm_create(len / PAGE_SIZE,&shm);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  //-- the range keeps the segment; a failed attach frees it --//
+  ret = vmm_shm_attach(vm,shm,start);
+  id  = shm->id;
+  vmm_shm_put(shm);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  thisTask->allocated_pages_mem += len;
+  FN_LEAVE();
+  return id;
+}
+
+
+/** @function  syscall_shm_attach
+ *  @brief     This function implements the shm_attach system call
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM on an
+ *             unaligned address; KERN_ERROR_GENERIC if there is no
+ *             segment by that id; KERN_PAGE_ERR if it does not fit
+ *             at the given address; KERN_NO_MEM when out of memory
+ *             or over the quota
+ */
+
+KERN_RET_CODE syscall_shm_attach(void *user_param_packet) {
+  uint32_t        params[2];
+  int             id;
+  unsigned long   start;
+  unsigned long   len;
+  vmm_shm        *shm;
+  ktask          *thisTask = (CURRENT_THREAD)->pTask;
+  struct task_vm *vm = &thisTask->vm;
+  KERN_RET_CODE   ret;
+  FN_ENTRY();
+
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  id    = (int)params[0];
+  start = params[1];
+
+  //-- the segment's size is checked against the address on attach --//
+  if( start < USER_MEM_START || ( start & PAGE_MASK ) ) {
+    DUMP("Failure: Parameter check failed for shm_attach syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+
+  shm = vmm_shm_find(id);
+  if( NULL == shm )
+    return KERN_ERROR_GENERIC;
+
+  len = shm->nr_pages * PAGE_SIZE;
+  if( thisTask->allocated_pages_mem + len > (unsigned long)ALLOC_MEM_QUOTA ) {
+    vmm_shm_put(shm);
+    return KERN_NO_MEM;
+  }
+
+  ret = vmm_shm_attach(vm,shm,start);
+  vmm_shm_put(shm);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  thisTask->allocated_pages_mem += len;
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
+
+
+/** @function  syscall_shm_detach
+ *  @brief     This function implements the shm_detach system call
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    KERN_SUCCESS on success; KERN_ERROR_ADDRESS_NOT_PRESENT if
+ *             no segment is attached at the given address; KERN_NO_MEM
+ *             if a page table shared after fork could not be copied
+ */
+
+KERN_RET_CODE syscall_shm_detach(void *user_param_packet) {
+  unsigned long   start;
+  unsigned long   len;
+  ktask          *thisTask = (CURRENT_THREAD)->pTask;
+  struct task_vm *vm = &thisTask->vm;
+  vm_range       *range;
+  KERN_RET_CODE   ret;
+  FN_ENTRY();
+
+  start = (unsigned long)GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
+
+  //-- the range goes with the detach; keep what it was charged --//
+  range = vmm_range_tree_find_start(vm,start);
+  if( NULL == range || NULL == range->shm )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+  len = range->len;
+
+  ret = vmm_shm_detach(vm,start);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  thisTask->allocated_pages_mem -= len;
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/** @file     syscall_spawn.c
+ *  @brief    This file contains the system call handler for spawn()
+ *
+ *            spawn() is fork() immediately followed by exec() in the
+ *            child, without the fork. The child task is built directly
+ *            around the new program; the parent's page tables are never
+ *            shared, so its frames keep their refcounts and it takes no
+ *            copy on write faults afterwards.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+#include <x86/cr.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include <loader_internal.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+#include <sched.h>
+
+
+/** @function  spawn_copy_argv_to_stack
+ *  @brief     This function copies the arguments onto the user stack of
+ *             a task that is not running
+ *  @param     task      - the new task
+ *  @param     stack     - top of its user stack
+ *  @param     newStack  - placeholder of the user stack pointer to start with
+ *  @param     exec_args - arguments to the program
+ *  @return    void
+ */
+
+static void spawn_copy_argv_to_stack(ktask     *task,
+				     char      *stack,
+				     char     **newStack,
+				     exec_args *exec_args)
+{
+  uint32_t eflags;
+
+  //-- the stack is backed and the kernel is mapped in every task; --//
+  //-- borrow the child's address space while nobody can switch.   --//
+  //-- no fault may happen here: it would be resolved against the  --//
+  //-- parent's VM, so load_elf_stage backs every byte written     --//
+  eflags = disable_preemption();
+  set_cr3( (uint32_t)task->vm.pde_base );
+  exec_copy_argv_to_stack(stack,newStack,exec_args);
+  set_cr3( (uint32_t)CURRENT_THREAD->pTask->vm.pde_base );
+  enable_preemption(eflags);
+}
+
+
+/** @function  thread_setup_ret_from_spawn
+ *  @brief     This function sets up the initial thread stack of the
+ *             spawned task so it starts at the program's entry point
+ *  @param     thread  - the initial_thread of the spawned task
+ *  @param     u_stack - user stack pointer to start with
+ *  @param     entry   - entry point of the program
+ *  @return    void
+ */
+
+static void thread_setup_ret_from_spawn(kthread       *thread,
+					unsigned long  u_stack,
+					unsigned long  entry)
+{
+  i386_context u_context,switch_context;
+
+  memset(&u_context,0,sizeof(u_context));
+  memset(&switch_context,0,sizeof(switch_context));
+
+  u_context.u.es = SEGSEL_USER_DS;
+  u_context.u.ds = SEGSEL_USER_DS;
+
+  switch_context.u.es = SEGSEL_KERNEL_DS;
+  switch_context.u.ds = SEGSEL_KERNEL_DS;
+
+  thread_setup_ret_from_syscall(thread,
+				(STACK_ELT) u_stack,        // esp
+				(STACK_ELT) entry,          // eip
+				0,                          // error code
+				&u_context,
+				&switch_context             // all start here
+				);
+}
+
+
+/** @function  syscall_spawn
+ *  @brief     This function implements the spawn system call
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    child task threadID on success; KERN err code on failure
+ */
+
+KERN_RET_CODE syscall_spawn(void *user_param_packet) {
+  KERN_RET_CODE  ret;
+  exec_args     *local_exec_args;
+  vmm_exec_stage stage;
+  task_vm        layout;
+  unsigned long  start_address;
+  unsigned long  u_stack,new_u_stack;
+  ktask         *thisTask = (CURRENT_THREAD)->pTask;
+  ktask         *newTask;
+  kthread       *newThread;
+  FN_ENTRY();
+
+  task_fork_lock(thisTask);
+
+  //-- Get the filename and argv out; same packet as exec --//
+  ret = exec_copy_argv(user_param_packet,&local_exec_args);
+  if( KERN_SUCCESS != ret ) {
+    task_fork_unlock(thisTask);
+    return ret;
+  }
+  DUMP("syscall_spawn params %s",local_exec_args->filename);
+
+  //-- stage the program before there is a task to undo --//
+  ret = load_elf_stage(local_exec_args->filename,
+		       EXEC_ARGS_STACK_BYTES(local_exec_args->argc,
+					     local_exec_args->data_len),
+		       &stage,
+		       &layout,
+		       &start_address);
+  if( KERN_SUCCESS != ret ) {
+    exec_free_args(local_exec_args);
+    task_fork_unlock(thisTask);
+    return ret;
+  }
+
+  // -- intialize the new task -- //
+  ret = vmm_init_task_vm( thisTask , &newTask );
+  if( KERN_SUCCESS != ret ) {
+    DUMP( "task Creation failed %d" , ret );
+    vmm_exec_stage_abort(&stage);
+    exec_free_args(local_exec_args);
+    task_fork_unlock(thisTask);
+    return ret;
+  }
+  newThread = &newTask->initial_thread;
+
+  //-- nothing fails from here on --//
+  load_elf_commit(newTask,&stage,&layout,&u_stack);
+  spawn_copy_argv_to_stack(newTask,
+			   (char  *)  u_stack,
+			   (char **) &new_u_stack,
+			   local_exec_args);
+  exec_free_args(local_exec_args);
+
+  thread_setup_ret_from_spawn(newThread,new_u_stack,start_address);
+  scheduler_add( newThread );
+
+  task_fork_unlock(thisTask);
+  FN_LEAVE();
+  return (KERN_RET_CODE) newThread;
+}
@@ -43,6 +43,7 @@ KERN_RET_CODE syscall_taskvanish(void *user_param_packet) {
   Q_FOREACH( thread , &thisTask->ktask_threads_head , kthread_next ) {
 
       Q_REMOVE( &thisTask->ktask_threads_head , thread , kthread_next );
+      thread_unregister( thread );
       scheduler_remove(thread);
       if(CURRENT_THREAD->pTask->ktask_threads_head.nr_elements == 0) {
 	CURRENT_THREAD->pTask->state = TASK_STATUS_ZOMIE;
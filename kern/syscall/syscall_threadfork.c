@@ -66,10 +66,10 @@ KERN_RET_CODE syscall_threadfork(void *user_param_packet) {
   //
   // --                              -- //
 
-  threadmem = smemalign( PAGE_SIZE * KTHREAD_KSTACK_PAGES, PAGE_SIZE * KTHREAD_KSTACK_PAGES );
+  //-- only the thread struct is cleared; the frames below fill the rest --//
+  threadmem = (char *) vmm_kstack_alloc();
   if( NULL == threadmem )
     return KERN_NO_MEM;
-  memset( threadmem , 0 , PAGE_SIZE * KTHREAD_KSTACK_PAGES );
 
   newThread = (kthread *) threadmem;
   newThread->pTask = thisTask;
@@ -92,6 +92,7 @@ KERN_RET_CODE syscall_threadfork(void *user_param_packet) {
   Q_INSERT_FRONT( &thisTask->ktask_threads_head,
 		  newThread,
 		  kthread_next);
+  thread_register( newThread );
 
   thread_setup_ret_from_fork(newThread);
   scheduler_add( newThread );
@@ -46,6 +46,7 @@ KERN_RET_CODE syscall_vanish(void *user_param_packet) {
   Q_FOREACH( thread , &thisTask->ktask_threads_head , kthread_next ) {
     if(thread == (CURRENT_THREAD)) {
       Q_REMOVE( &thisTask->ktask_threads_head , thread , kthread_next );
+      thread_unregister( thread );
       if(thisTask->ktask_threads_head.nr_elements == 0) {
 	thisTask->state = TASK_STATUS_ZOMIE;
 	//- we cannot be scheduled anymore now -//
@@ -56,6 +57,12 @@ KERN_RET_CODE syscall_vanish(void *user_param_packet) {
   }
   
   task_fork_unlock(thisTask);
+
+  //- a forked thread's stack is freed once we are off it; no tick -//
+  //- may make us runnable again before we switch away            -//
+  disable_preemption();
+  if( (CURRENT_THREAD) != &thisTask->initial_thread )
+    vmm_kstack_free_self();
   
   //- you may or may not come back here-//
   schedule(0);
@@ -25,11 +25,14 @@
 /** @function  syscall_wait
  *  @brief     This function implements the wait system call
  *  @param     user_param_packet - %esi as passed down from user mode
- *  @return    On success, this will never return
+ *  @return    tid of the reaped child on success; KERN err code on failure.
+ *             KERN_ERR_BAD_SYS_PARAM if the status cannot be written; the
+ *             child is reaped all the same
  */
 
 KERN_RET_CODE syscall_wait(void *user_param_packet)  {
   int *user_status; 
+  int status;
   ktask *pTaskTrav=NULL;
   KERN_RET_CODE retval;
 
@@ -66,12 +69,17 @@ KERN_RET_CODE syscall_wait(void *user_param_packet)  {
   
   //- Perform last rites and clean up -//
   Q_REMOVE( &(CURRENT_THREAD)->pTask->ktask_task_head, pTaskTrav , ktask_next );
-  *user_status = pTaskTrav->status;
+  status = pTaskTrav->status;
   
   retval = (KERN_RET_CODE)&pTaskTrav->initial_thread;
   
   // -- free up the space used by the waited task -- //
   vmm_free_task_vm(pTaskTrav);
   task_fork_unlock((CURRENT_THREAD)->pTask);	
+
+  // -- NULL means the caller does not want the status -- //
+  if( user_status &&
+      KERN_SUCCESS != vmm_copy_to_user(user_status,&status,sizeof(int)) )
+    return KERN_ERR_BAD_SYS_PARAM;
   return retval;
 }
@@ -0,0 +1,69 @@
+/** @file     syscall_wss_stats.c
+ *  @brief    This file contains the system call handler for wss_stats()
+ *
+ *            wss_stats() reports the working set estimate the timer
+ *            keeps for a task from its accessed bits; see vmm_wss.c. It
+ *            is meant for sizing memory quotas per workload, together
+ *            with memstats().
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <x86/seg.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <asm.h>
+#include <kern_common.h>
+#include <syscall_int.h>
+#include <syscall_entry.h>
+#include "syscall_internal.h"
+#include "i386lib/i386systemregs.h"
+
+
+/** @function  syscall_wss_stats
+ *  @brief     This function implements the wss_stats system call
+ *             it fills in the working set statistics of a task
+ *  @param     user_param_packet - %esi as passed down from user mode
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM if there
+ *             is no such thread or the buffer cannot be written
+ */
+
+KERN_RET_CODE syscall_wss_stats(void *user_param_packet) {
+  uint32_t     params[2];
+  int          tid;
+  wss_stats_t *stats;
+  wss_stats_t  last;
+  kthread     *thread;
+  uint32_t     eflags;
+  FN_ENTRY();
+
+  if( KERN_SUCCESS != vmm_copy_from_user(params,user_param_packet,sizeof(params)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  tid   = (int)params[0];
+  stats = (wss_stats_t *)params[1];
+
+  //-- -1 asks about the calling task; any thread names its task --//
+  //-- which stays around while preemption is off                --//
+  eflags = disable_preemption();
+  thread = ( -1 == tid ) ? CURRENT_THREAD : thread_lookup(tid);
+  if( NULL == thread ) {
+    enable_preemption(eflags);
+    DUMP("Failure: Parameter check failed for wss_stats syscall");
+    return KERN_ERR_BAD_SYS_PARAM;
+  }
+  vmm_wss_get_stats(&thread->pTask->vm,&last);
+  enable_preemption(eflags);
+
+  if( KERN_SUCCESS != vmm_copy_to_user(stats,&last,sizeof(last)) )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
@@ -48,11 +48,22 @@
 
 KERN_RET_CODE syscall_yield(void *user_param_packet) {
   kthread *thread;
+  uint32_t eflags;
+  int      tid;
   FN_ENTRY();
 
-  thread = (kthread *) GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
-  if( thread->run_flag < 0 )
-    return KERN_ERROR_GENERIC;
+  tid = (int) GET_NTH_PARAM_FROM_PACKET(user_param_packet,0);
+
+  // -- the target may have vanished since the parameter check -- //
+  if( -1 != tid ) {
+    eflags = disable_preemption();
+    thread = thread_lookup(tid);
+    if( NULL == thread || thread->run_flag < 0 ) {
+      enable_preemption(eflags);
+      return KERN_ERROR_GENERIC;
+    }
+    enable_preemption(eflags);
+  }
 
   schedule(CURRENT_RUNNABLE);
 
@@ -24,56 +24,6 @@
 //-- the vm manager context for the kernel --//
 kern_vmm kernel_vmm;
 
-/** @function  vmm_get_free_user_pages
- *  @brief     This function is used to get user page frames
- *  @param     pfn - pointer to frame number holder
- *  @return    KERN_SUCCESS on successful get; else KERN_NO_MEM
- */
-
-KERN_RET_CODE vmm_get_free_user_pages(PFN *pfn) {
-  int i;
-
-  for(i=KERNEL_PAGES_NR+1;i<kernel_vmm.nr_physical_pages;i++) {
-    assert( kernel_vmm.m_pages[i].refcount >= 0 );
-    if(!kernel_vmm.m_pages[i].refcount) {
-      kernel_vmm.m_pages[i].refcount = 1;
-      *pfn = (PFN) i;
-      return KERN_SUCCESS;
-    }
-  }
-
-  return KERN_NO_MEM;
-}
-
-/** @function  vmm_getref_user_page
- *  @brief     This function is used to increment refcount for a frame - share (COW)
- *  @param     pfn - frame number holder
- *  @return    void
- */
-
-void vmm_getref_user_page(PFN pfn) {
-  assert(pfn < kernel_vmm.nr_physical_pages);
-  assert(pfn >= KERNEL_PAGES_NR + 1);
-
-  assert(kernel_vmm.m_pages[pfn].refcount >= 1);
-  // -- there is one reference from getfreepages -- //
-
-  kernel_vmm.m_pages[pfn].refcount++;
-}
-
-/** @function  vmm_putref_user_page
- *  @brief     This function is used to decrement refcount for a frame - unshare (COW)
- *  @param     pfn - frame number holder
- *  @return    void
- */
-
-void vmm_putref_user_page(PFN pfn) {
-  assert(pfn < kernel_vmm.nr_physical_pages);
-  assert(pfn >= KERNEL_PAGES_NR + 1);
-  kernel_vmm.m_pages[pfn].refcount--;
-  assert(kernel_vmm.m_pages[pfn].refcount >= 0);
-}
-
 /** @function  vmm_init_task_vm
  *  @brief     This function is used to initialize a task's VM
  *  @param     parentTask - pointer to the parentTask that forks new task
@@ -86,23 +36,15 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
   char *taskmem;
   int  totalTaskAllocation;
   int  i;
-  int  initial_pte_pages;
 
   PTE    *pde_base;
-  PTE    *pte_base;
   ktask  *newTask;
 
   FN_ENTRY();
 
-  //- Calculate the PTE pages required for covering the kernel range--//
-  initial_pte_pages = KERNEL_PAGES_NR / PTE_PER_PAGE;
-  if( KERNEL_PAGES_NR % PTE_PER_PAGE )
-    initial_pte_pages =+ 1;
-
-
   //-- Get the total pages need to create a task --//
-  totalTaskAllocation = KTHREAD_KSTACK_PAGES  + INITIAL_PDE_PAGES
-    + initial_pte_pages;
+  //-- the kernel page tables are shared           --//
+  totalTaskAllocation = KTHREAD_KSTACK_PAGES  + INITIAL_PDE_PAGES;
   totalTaskAllocation *= PAGE_SIZE;
 
   taskmem = smemalign(PAGE_SIZE * KTHREAD_KSTACK_PAGES ,totalTaskAllocation);
@@ -113,11 +55,10 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
 
   //-- Fix up pointers upfront --//
   pde_base = (PTE *) (taskmem  + (PAGE_SIZE * KTHREAD_KSTACK_PAGES));
-  pte_base = (PTE *) ((char *) pde_base +  (PAGE_SIZE * INITIAL_PDE_PAGES));
 
 
-  //--  the PDE page --//
-  for(i=0 ; i < initial_pte_pages ; i++) {
+  //--  the PDE page points at the shared direct map --//
+  for(i=0 ; i < KERNEL_PTE_PAGES ; i++) {
     pde_base[i].PRESENT         = 1;
     pde_base[i].RW              = 1;
     pde_base[i].US              = 0;
@@ -128,26 +69,18 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
     pde_base[i]._PAGE_SIZE      = 0;
     pde_base[i].GLOBAL          = 1;
     pde_base[i].AVAIL           = 0;
-    //- Initial PTE's are contigious -//
-    pde_base[i].ADDRESS         = ((unsigned long)pte_base & ~(PAGE_MASK)) >> PAGING_PAGE_OFFSET_BITS;
-    pde_base[i].ADDRESS        += i;
-  }
 
-  //-- the direct mapped PTE pages --//
-  for(i=0;i<KERNEL_PAGES_NR;i++) {
-    pte_base[i].PRESENT         = 1;
-    pte_base[i].RW              = 1;
-    pte_base[i].US              = 0;
-    pte_base[i].WT              = 0;
-    pte_base[i].CACHE_DISABLED  = 0;
-    pte_base[i].ACCESSED        = 0;
-    pte_base[i].DIRTY           = 0;
-    pte_base[i]._PAGE_SIZE      = 0;
-    pte_base[i].GLOBAL          = 1;
-    pte_base[i].AVAIL           = 0;
+    //- whole 4MB of direct map; one large page instead of a PTE page -//
+    if( i != kernel_vmm.kmap_pde_idx &&
+	(i + 1) * PTE_PER_PAGE <= KERNEL_PAGES_NR ) {
+      pde_base[i]._PAGE_SIZE    = 1;
+      pde_base[i].ADDRESS       = i * PTE_PER_PAGE;
+      continue;
+    }
 
-    //- Direct Map -//
-    pte_base[i].ADDRESS         = i;
+    //- Kernel PTE's are contigious -//
+    pde_base[i].ADDRESS         = ((unsigned long)kernel_vmm.kernel_pte_base & ~(PAGE_MASK)) >> PAGING_PAGE_OFFSET_BITS;
+    pde_base[i].ADDRESS        += i;
   }
 
   //-- Store the task struct on the stack itself -//
@@ -183,6 +116,7 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
   Q_INSERT_FRONT( &newTask->vm.vm_ranges_head  ,
 		  &newTask->vm.vm_range_kernel ,
 		  vm_range_next);
+  newTask->vm.vm_range_root = NULL;
 
 
   //-- Initialize list of children & wait semaphore--//
@@ -195,6 +129,7 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
 		  &newTask->initial_thread,
 		  kthread_next);
   newTask->initial_thread.pTask = newTask;
+  thread_register( &newTask->initial_thread );
 
   //-- Initialize the waiting list --//
   Q_INIT_ELEM( &newTask->initial_thread , kthread_wait );
@@ -235,6 +170,20 @@ KERN_RET_CODE vmm_init_task_vm(ktask  *parentTask,
   return KERN_SUCCESS;
 }
 
+/** @function  range_free
+ *  @brief     This function gives a range node back to its cache along
+ *             with the range's reference on its segment
+ *  @param     range - range node off every list
+ *  @return    void
+ */
+
+static void range_free(vm_range *range) {
+  if( range->shm )
+    vmm_shm_put(range->shm);
+  vmm_cache_free(&kernel_vmm.range_cache,range);
+}
+
+
 /** @function  vmm_free_all_vma
  *  @brief     This function is used to destroy the vm ranges of a given task
  *  @param     vm_dst - pointer to the VMmanager of a task which will be destroyed
@@ -253,8 +202,9 @@ void vmm_free_all_vma( struct task_vm *vm_dst ) {
     Q_REMOVE(&vm_dst->vm_ranges_head,
 	     vmrange_ptr,
 	     vm_range_next);
-    free(vmrange_ptr);
+    range_free(vmrange_ptr);
   }
+  vm_dst->vm_range_root = NULL;
 }
 
 
@@ -293,6 +243,18 @@ void vmm_free_task_vm(ktask *pTask) {
 //-- --//
 #define MINIMUM_PAGES_TO_OPERATE 12
 
+/** @function  pte_page_ctor
+ *  @brief     This function zeroes a page table page as it enters the
+ *             page table cache; vmm_putref_pte_page zeroes it again
+ *             before giving it back
+ *  @param     obj - the page
+ *  @return    void
+ */
+
+static void pte_page_ctor(void *obj) {
+  memset(obj,0,PAGE_SIZE);
+}
+
 /** @function  vmm_init
  *  @brief     This function is used to initialize the VMmanager globally
  *             It maintains the physical frames available in RAM
@@ -302,10 +264,22 @@ void vmm_free_task_vm(ktask *pTask) {
  */
 
 KERN_RET_CODE vmm_init(void) {
+  int i;
   FN_ENTRY();
 
   memset(&kernel_vmm,0,sizeof(kernel_vmm));
 
+  //-- object caches; nothing is allocated until first use --//
+  vmm_cache_init(&kernel_vmm.range_cache,"vm_range",
+		 sizeof(vm_range),sizeof(void *),NULL);
+  vmm_cache_init(&kernel_vmm.pte_cache,"pte_page",
+		 PAGE_SIZE,PAGE_SIZE,pte_page_ctor);
+  vmm_cache_init(&kernel_vmm.kstack_cache,"kstack",
+		 PAGE_SIZE * KTHREAD_KSTACK_PAGES,
+		 PAGE_SIZE * KTHREAD_KSTACK_PAGES,NULL);
+  kernel_vmm.kstack_cache.max_free = VMM_KSTACK_CACHED;
+  vmm_cache_init(&kernel_vmm.exec_args_cache,"exec_args",
+		 VMM_EXEC_ARGS_BYTES,sizeof(void *),NULL);
 
   //- Get the total number of pages available --//
   kernel_vmm.nr_physical_pages = machine_phys_frames();
@@ -319,10 +293,38 @@ KERN_RET_CODE vmm_init(void) {
     return KERN_NO_MEM;
   }
 
-  kernel_vmm.nr_free_pages -= KERNEL_PAGES_NR;
+  //-- build the direct mapped PTE pages once --//
+  kernel_vmm.kernel_pte_base = smemalign(PAGE_SIZE,KERNEL_PTE_PAGES * PAGE_SIZE);
+  if( !kernel_vmm.kernel_pte_base ){
+    FN_LEAVE();
+    return KERN_NO_MEM;
+  }
+  memset(kernel_vmm.kernel_pte_base,0,KERNEL_PTE_PAGES * PAGE_SIZE);
 
-  //-- Start the page manager --//
-  kernel_vmm.next_free_page = KERNEL_PAGES_NR + 1;
+  for(i=0;i<KERNEL_PAGES_NR;i++) {
+    kernel_vmm.kernel_pte_base[i].PRESENT         = 1;
+    kernel_vmm.kernel_pte_base[i].RW              = 1;
+    kernel_vmm.kernel_pte_base[i].US              = 0;
+    kernel_vmm.kernel_pte_base[i].WT              = 0;
+    kernel_vmm.kernel_pte_base[i].CACHE_DISABLED  = 0;
+    kernel_vmm.kernel_pte_base[i].ACCESSED        = 0;
+    kernel_vmm.kernel_pte_base[i].DIRTY           = 0;
+    kernel_vmm.kernel_pte_base[i]._PAGE_SIZE      = 0;
+    kernel_vmm.kernel_pte_base[i].GLOBAL          = 1;
+    kernel_vmm.kernel_pte_base[i].AVAIL           = 0;
+
+    //- Direct Map -//
+    kernel_vmm.kernel_pte_base[i].ADDRESS         = i;
+  }
+
+  //-- kernel window to reach user frames that are not direct mapped --//
+  //-- aligned to its size so all the slots share one page table    --//
+  kernel_vmm.kmap_window = smemalign(KMAP_SLOTS * PAGE_SIZE,KMAP_SLOTS * PAGE_SIZE);
+  if( !kernel_vmm.kmap_window ){
+    FN_LEAVE();
+    return KERN_NO_MEM;
+  }
+  kernel_vmm.kmap_pde_idx = (unsigned long)kernel_vmm.kmap_window / LARGE_PAGE_SIZE;
 
   //-- allocate the mpage structs --//
   kernel_vmm.m_pages = malloc(sizeof(m_page) * kernel_vmm.nr_physical_pages);
@@ -331,12 +333,634 @@ KERN_RET_CODE vmm_init(void) {
     return KERN_NO_MEM;
   }
   memset(kernel_vmm.m_pages,0,sizeof(m_page) * kernel_vmm.nr_physical_pages);
+
+  //-- Start the page manager; the RAM disk for swap is kept out --//
+  vmm_swap_init();
+  vmm_buddy_init();
+
+  //-- the zero frame backs read faults on untouched pages --//
+  //-- the reference taken here pins it for good          --//
+  if( KERN_SUCCESS != vmm_get_free_user_pages(&kernel_vmm.zero_pfn) ) {
+    FN_LEAVE();
+    return KERN_NO_MEM;
+  }
+  vmm_zero_user_page(kernel_vmm.zero_pfn);
+
+  //-- the idle thread fills the pre-zeroed pool --//
+  kernel_vmm.zero_pool_head = PFN_NULL;
+  kernel_vmm.zero_pool_nr   = 0;
+
   FN_LEAVE();
   return KERN_SUCCESS;
 }
 
 
 
+/** @function  invalidate_tlb
+ *  @brief     This function invalidates the tlb using the asm INVLPG instruction
+ *  @param     addr - faulting address requiring action
+ *  @return    void
+ */
+
+static inline void invalidate_tlb(unsigned long addr)
+{
+        asm volatile("invlpg (%0)" ::"r" (addr) : "memory");
+}
+
+
+/** @function  vmm_kmap
+ *  @brief     This function maps a user frame into a kmap window slot
+ *  @param     slot - KMAP_SRC_SLOT or KMAP_DST_SLOT
+ *  @param     pfn  - user frame to map
+ *  @note      called with preemption disabled; the window is shared
+ *             by all tasks since the kernel page tables are
+ *  @return    kernel address of the frame
+ */
+
+static char *vmm_kmap(int slot,PFN pfn) {
+  char *vaddr = kernel_vmm.kmap_window + (slot * PAGE_SIZE);
+  PTE  *pte   = &kernel_vmm.kernel_pte_base[(unsigned long)vaddr >> PAGING_PAGE_OFFSET_BITS];
+
+  //-- before paging is turned on every frame is reachable as is --//
+  if( !(get_cr0() & CR0_PG) )
+    return (char *)(pfn << PAGING_PAGE_OFFSET_BITS);
+
+  pte->ADDRESS = pfn;
+  invalidate_tlb((unsigned long)vaddr);
+  return vaddr;
+}
+
+
+/** @function  vmm_kunmap
+ *  @brief     This function restores the direct map of a kmap window slot
+ *  @param     slot - KMAP_SRC_SLOT or KMAP_DST_SLOT
+ *  @return    void
+ */
+
+static void vmm_kunmap(int slot) {
+  char *vaddr = kernel_vmm.kmap_window + (slot * PAGE_SIZE);
+  PTE  *pte   = &kernel_vmm.kernel_pte_base[(unsigned long)vaddr >> PAGING_PAGE_OFFSET_BITS];
+
+  if( !(get_cr0() & CR0_PG) )
+    return;
+
+  pte->ADDRESS = (unsigned long)vaddr >> PAGING_PAGE_OFFSET_BITS;
+  invalidate_tlb((unsigned long)vaddr);
+}
+
+
+/** @function  vmm_copy_user_page
+ *  @brief     This function copies the contents of one user frame to another
+ *  @param     dst_pfn - destination frame
+ *  @param     src_pfn - source frame
+ *  @return    void
+ */
+
+void vmm_copy_user_page(PFN dst_pfn,PFN src_pfn) {
+  uint32_t eflags;
+  char *src,*dst;
+
+  eflags = disable_preemption();
+  src = vmm_kmap(KMAP_SRC_SLOT,src_pfn);
+  dst = vmm_kmap(KMAP_DST_SLOT,dst_pfn);
+  memcpy(dst,src,PAGE_SIZE);
+  vmm_kunmap(KMAP_DST_SLOT);
+  vmm_kunmap(KMAP_SRC_SLOT);
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_zero_user_page
+ *  @brief     This function fills a user frame with zeroes
+ *  @param     pfn - frame to clear
+ *  @return    void
+ */
+
+void vmm_zero_user_page(PFN pfn) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  memset(vmm_kmap(KMAP_DST_SLOT,pfn),0,PAGE_SIZE);
+  vmm_kunmap(KMAP_DST_SLOT);
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_fill_user_page
+ *  @brief     This function copies bytes from kernel memory into part
+ *             of a user frame
+ *  @param     pfn    - frame to fill
+ *  @param     offset - offset in the frame of the first byte
+ *  @param     src    - bytes to copy
+ *  @param     len    - number of bytes; offset + len <= PAGE_SIZE
+ *  @return    void
+ */
+
+void vmm_fill_user_page(PFN pfn,int offset,const char *src,int len) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  memcpy(vmm_kmap(KMAP_DST_SLOT,pfn) + offset,src,len);
+  vmm_kunmap(KMAP_DST_SLOT);
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_read_user_page
+ *  @brief     This function copies bytes out of part of a user frame
+ *             into kernel memory
+ *  @param     pfn    - frame to read
+ *  @param     offset - offset in the frame of the first byte
+ *  @param     dst    - where to copy to
+ *  @param     len    - number of bytes; offset + len <= PAGE_SIZE
+ *  @return    void
+ */
+
+void vmm_read_user_page(PFN pfn,int offset,char *dst,int len) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  memcpy(dst,vmm_kmap(KMAP_SRC_SLOT,pfn) + offset,len);
+  vmm_kunmap(KMAP_SRC_SLOT);
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_hash_user_page
+ *  @brief     This function hashes the contents of a user frame
+ *  @param     pfn  - frame to hash
+ *  @param     zero - placeholder; set to 1 if the frame is all zeroes
+ *  @return    FNV-1a hash of the frame's words
+ */
+
+uint32_t vmm_hash_user_page(PFN pfn,int *zero) {
+  uint32_t *words;
+  uint32_t  hash = 2166136261u;
+  uint32_t  any  = 0;
+  uint32_t  eflags;
+  int       i;
+
+  eflags = disable_preemption();
+  words = (uint32_t *)vmm_kmap(KMAP_SRC_SLOT,pfn);
+  for(i = 0; i < PAGE_SIZE / sizeof(uint32_t); i++) {
+    hash = ( hash ^ words[i] ) * 16777619u;
+    any |= words[i];
+  }
+  vmm_kunmap(KMAP_SRC_SLOT);
+  enable_preemption(eflags);
+
+  *zero = ( 0 == any );
+  return hash;
+}
+
+
+/** @function  vmm_same_user_pages
+ *  @brief     This function compares the contents of two user frames
+ *  @param     pfn1 - frame
+ *  @param     pfn2 - other frame
+ *  @return    1 if they hold the same bytes; 0 otherwise
+ */
+
+int vmm_same_user_pages(PFN pfn1,PFN pfn2) {
+  uint32_t eflags;
+  int      same;
+
+  eflags = disable_preemption();
+  same = ( 0 == memcmp(vmm_kmap(KMAP_SRC_SLOT,pfn1),
+		       vmm_kmap(KMAP_DST_SLOT,pfn2),
+		       PAGE_SIZE) );
+  vmm_kunmap(KMAP_DST_SLOT);
+  vmm_kunmap(KMAP_SRC_SLOT);
+  enable_preemption(eflags);
+
+  return same;
+}
+
+
+/** @function  vmm_alloc_pte_page
+ *  @brief     This function allocates a zeroed page table page
+ *             owned by a single page directory entry
+ *  @return    the page table; NULL if out of kernel memory
+ */
+
+PTE *vmm_alloc_pte_page(void) {
+  PTE *pte_page;
+
+  //-- cached pages are already zero --//
+  pte_page = vmm_cache_alloc( &kernel_vmm.pte_cache );
+  if( !pte_page )
+    return NULL;
+
+  kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].refcount = 1;
+  return pte_page;
+}
+
+
+/** @function  vmm_putref_pte_page
+ *  @brief     This function drops a page directory reference
+ *             to a page table, freeing it with the last reference
+ *  @param     pte_page - the page table
+ *  @return    void
+ */
+
+void vmm_putref_pte_page(PTE *pte_page) {
+  m_page *page = &kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)];
+
+  assert( page->refcount >= 1 );
+  page->refcount--;
+  if( 0 == page->refcount ) {
+    assert( NULL == page->rmap );
+    memset( pte_page , 0 , PAGE_SIZE );
+    vmm_cache_free( &kernel_vmm.pte_cache , pte_page );
+  }
+}
+
+
+/** @function  vmm_install_pte_page
+ *  @brief     This function makes sure there is a page table behind
+ *             the PDE covering a user address
+ *  @param     address_space - pointer to the task's VM
+ *  @param     address       - user address
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM on failure
+ */
+
+KERN_RET_CODE vmm_install_pte_page(struct task_vm *address_space,
+				   uint32_t address)
+{
+  PDE *pde;
+  PTE *new_pte;
+  vmm_rmap *pool = NULL;
+  uint32_t eflags;
+
+  pde = vmm_get_pde( address_space , address );
+  if( pde->PRESENT )
+    return KERN_SUCCESS;
+
+  if( KERN_SUCCESS != vmm_rmap_reserve( &pool , 1 ) ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  new_pte = vmm_alloc_pte_page();
+  if( !new_pte ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  //-- another thread may have installed one while we blocked --//
+  eflags = disable_preemption();
+  if( pde->PRESENT ) {
+    enable_preemption(eflags);
+    vmm_putref_pte_page( new_pte );
+    vmm_rmap_release( &pool );
+    return KERN_SUCCESS;
+  }
+
+  vmm_rmap_link( &pool , PTE_PAGE_PFN(new_pte) , address_space ,
+		 address & ~LARGE_PAGE_MASK , NULL );
+
+  //-- user PDEs are always writable; protection is in the PTEs --//
+  //-- a read only PDE marks a page table shared after fork     --//
+  pde->PRESENT = 1;
+  pde->RW      = 1;
+  pde->US      = 1;
+  pde->GLOBAL  = 0;
+  pde->ADDRESS = (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
+  enable_preemption(eflags);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_share_user_ptes
+ *  @brief     This function makes the destination VM share every user
+ *             page table of the source VM (fork). The page directory
+ *             entries are write protected in both; page tables are
+ *             unshared lazily on the first fault that modifies them
+ *  @param     address_space_dst - pointer to destination task's VM
+ *  @param     address_space_src - pointer to source task's VM
+ *  @return    KERN_SUCCESS on completion; KERN_NO_MEM when the reverse
+ *             mappings cannot be recorded - nothing is shared then
+ */
+
+KERN_RET_CODE vmm_share_user_ptes( struct task_vm *address_space_dst ,
+				   struct task_vm *address_space_src )
+{
+  int i,j;
+  int nr_shared = 0;
+  PDE *src_pde;
+  vmm_rmap *pool = NULL;
+  LINEAR_ADDRESS_BREAKER la;
+  FN_ENTRY();
+  la.address = USER_MEM_START;
+
+  //-- the child becomes one more owner of every table and 4MB page --//
+  for(i=la.u.PDE_IDX ; i  < PTE_PER_PAGE ; i++)
+    if( address_space_src->pde_base[i].PRESENT )
+      nr_shared++;
+
+  if( KERN_SUCCESS != vmm_rmap_reserve(&pool,nr_shared) ) {
+    vmm_rmap_release(&pool);
+    return KERN_NO_MEM;
+  }
+
+  for(i=la.u.PDE_IDX ; i  < PTE_PER_PAGE ; i++) {
+    src_pde = &address_space_src->pde_base[i];
+    if( !src_pde->PRESENT )
+      continue;
+
+    //-- a large page has no table; its frames become copy on write --//
+    if( src_pde->_PAGE_SIZE ) {
+      for(j=0 ; j < PTE_PER_PAGE ; j++)
+	vmm_getref_user_page(src_pde->ADDRESS + j);
+    }
+    else
+      kernel_vmm.m_pages[src_pde->ADDRESS].refcount++;
+
+    //-- a table's m_page or the first frame of the 4MB block --//
+    vmm_rmap_link(&pool,
+		  src_pde->ADDRESS,
+		  address_space_dst,
+		  i * LARGE_PAGE_SIZE,
+		  NULL);
+
+    src_pde->RW = 0;
+    address_space_dst->pde_base[i] = *src_pde;
+  }
+  assert( NULL == pool );
+
+  FN_LEAVE();
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_unshare_pte_page
+ *  @brief     This function gives the VM a private copy of the page table
+ *             covering address. Frames mapped by the shared table gain a
+ *             reference and become copy on write in both tables
+ *  @param     address_space - pointer to the task's VM
+ *  @param     address       - user address inside the shared table
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM on failure
+ */
+
+KERN_RET_CODE vmm_unshare_pte_page(struct task_vm *address_space,
+				   uint32_t address)
+{
+  PDE *pde;
+  PTE *old_pte,*new_pte;
+  vmm_rmap *pool = NULL;
+  uint32_t eflags;
+  int  nr_present = 0;
+  int  i;
+
+  pde = vmm_get_pde( address_space , address );
+  assert( pde->PRESENT );
+  assert( !pde->_PAGE_SIZE );
+  if( pde->RW )
+    return KERN_SUCCESS;
+
+  old_pte = PDE_PTE_PAGE(pde);
+
+  //-- last one holding the table; just take it over --//
+  if( 1 == kernel_vmm.m_pages[PTE_PAGE_PFN(old_pte)].refcount ) {
+    pde->RW = 1;
+    goto flush;
+  }
+
+  //-- the copy is owned by us and its slots map the same frames --//
+  for(i=0 ; i < PTE_PER_PAGE ; i++)
+    if( old_pte[i].PRESENT )
+      nr_present++;
+  if( KERN_SUCCESS != vmm_rmap_reserve( &pool , nr_present + 1 ) ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  new_pte = vmm_alloc_pte_page();
+  if( !new_pte ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  //-- another thread may have unshared it while we blocked; slots  --//
+  //-- of a shared table are only ever dropped, never added, so the --//
+  //-- entries counted above still cover it                         --//
+  eflags = disable_preemption();
+  if( pde->RW || PDE_PTE_PAGE(pde) != old_pte ) {
+    enable_preemption(eflags);
+    vmm_putref_pte_page( new_pte );
+    vmm_rmap_release( &pool );
+    return KERN_SUCCESS;
+  }
+
+  for(i=0 ; i < PTE_PER_PAGE ; i++) {
+    if( old_pte[i].PRESENT ) {
+      vmm_getref_user_page(old_pte[i].ADDRESS);
+      vmm_rmap_link( &pool , old_pte[i].ADDRESS , NULL , 0 , &new_pte[i] );
+      old_pte[i].RW = 0;
+    }
+    //-- both slots now hold the swapped out page --//
+    else if( PTE_IS_SWAPPED(&old_pte[i]) )
+      vmm_swap_dup( old_pte[i].ADDRESS );
+    new_pte[i] = old_pte[i];
+  }
+
+  address &= ~LARGE_PAGE_MASK;
+  vmm_rmap_link( &pool , PTE_PAGE_PFN(new_pte) , address_space , address , NULL );
+  pde->ADDRESS = (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
+  pde->RW      = 1;
+  enable_preemption(eflags);
+
+  vmm_rmap_remove( PTE_PAGE_PFN(old_pte) , address_space , address , NULL );
+  //-- zero frame slots took no entries --//
+  vmm_rmap_release( &pool );
+  vmm_putref_pte_page(old_pte);
+
+ flush:
+  //-- the whole 4MB window changed under the running task --//
+  vmm_tlb_flush_all( address_space );
+  return KERN_SUCCESS;
+}
+
+
+/** @function  large_page_release
+ *  @brief     This function clears a 4MB PDE and then drops the
+ *             references it held on its frames
+ *  @param     address_space - pointer to the task's VM
+ *  @param     pde           - large PDE
+ *  @param     address       - user address inside the 4MB page
+ *  @return    void
+ */
+
+static void large_page_release(struct task_vm *address_space,
+			       PDE *pde,
+			       unsigned long address) {
+  PFN base = pde->ADDRESS;
+  int i;
+
+  assert( PDE_IS_LARGE(pde) );
+  pde->PRESENT    = 0;
+  pde->_PAGE_SIZE = 0;
+  pde->ADDRESS    = 0;
+  vmm_tlb_flush_page( address_space , address );
+  vmm_rmap_remove( base , address_space , address & ~LARGE_PAGE_MASK , NULL );
+
+  for(i=0 ; i < PTE_PER_PAGE ; i++)
+    vmm_putref_user_page(base + i);
+}
+
+
+/** @function  vmm_install_large_range
+ *  @brief     This function installs a 4MB aligned range backed by
+ *             4MB pages, each one a max order buddy block
+ *  @param     address_space - pointer to the task's VM
+ *  @param     range         - range to install; start and len must be
+ *                             multiples of LARGE_PAGE_SIZE
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when there are not
+ *             enough free 4MB blocks - nothing is installed then
+ */
+
+KERN_RET_CODE vmm_install_large_range(struct task_vm *address_space,
+				      vm_range *range)
+{
+  KERN_RET_CODE ret;
+  unsigned long linear_address;
+  PDE *pde;
+  PFN  pfn;
+  int  i;
+
+  assert( !(range->start & LARGE_PAGE_MASK) );
+  assert( range->len && !(range->len & LARGE_PAGE_MASK) );
+
+  range->flags |= VM_RANGE_LARGE;
+  ret = vmm_install_range( address_space , range );
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  for(linear_address = range->start;
+      linear_address < range->start + range->len;
+      linear_address += LARGE_PAGE_SIZE) {
+    ret = vmm_alloc_user_pages(LARGE_PAGE_ORDER,&pfn);
+    if( KERN_SUCCESS == ret ) {
+      ret = vmm_rmap_add( pfn , address_space , linear_address , NULL );
+      if( KERN_SUCCESS != ret )
+	vmm_free_user_pages( pfn , LARGE_PAGE_ORDER );
+    }
+    if( KERN_SUCCESS != ret ) {
+      //-- drops the 4MB pages installed so far --//
+      vmm_uninstall_range( address_space , range );
+      return ret;
+    }
+
+    for(i=0 ; i < PTE_PER_PAGE ; i++)
+      vmm_zero_user_page(pfn + i);
+
+    //-- no range covers this 4MB; a table left over here maps nothing --//
+    pde = vmm_get_pde( address_space , linear_address );
+    if( pde->PRESENT ) {
+      vmm_rmap_remove( PTE_PAGE_PFN(PDE_PTE_PAGE(pde)) ,
+		       address_space ,
+		       linear_address ,
+		       NULL );
+      vmm_putref_pte_page( PDE_PTE_PAGE(pde) );
+    }
+
+    pde->PRESENT    = 1;
+    pde->RW         = 1;
+    pde->US         = 1;
+    pde->_PAGE_SIZE = 1;
+    pde->GLOBAL     = 0;
+    pde->ADDRESS    = pfn;
+    vmm_tlb_flush_page( address_space , linear_address );
+  }
+
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_split_large_page
+ *  @brief     This function replaces a 4MB mapping by a page table
+ *             mapping the same frames with the same protection
+ *  @param     address_space - pointer to the task's VM
+ *  @param     address       - user address inside the 4MB page
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM on failure
+ */
+
+KERN_RET_CODE vmm_split_large_page(struct task_vm *address_space,
+				   uint32_t address)
+{
+  PDE *pde;
+  PTE *new_pte;
+  vmm_rmap *pool = NULL;
+  int  i;
+
+  pde = vmm_get_pde( address_space , address );
+  if( !PDE_IS_LARGE(pde) )
+    return KERN_SUCCESS;
+
+  //-- one entry per frame and one for the new table's owner --//
+  if( KERN_SUCCESS != vmm_rmap_reserve( &pool , PTE_PER_PAGE + 1 ) ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  new_pte = vmm_alloc_pte_page();
+  if( !new_pte ) {
+    vmm_rmap_release( &pool );
+    return KERN_NO_MEM;
+  }
+
+  //-- the PTEs take over the references of the PDE --//
+  for(i=0 ; i < PTE_PER_PAGE ; i++) {
+    new_pte[i].PRESENT = 1;
+    new_pte[i].RW      = pde->RW;
+    new_pte[i].US      = 1;
+    new_pte[i].ADDRESS = pde->ADDRESS + i;
+    vmm_rmap_link( &pool , new_pte[i].ADDRESS , NULL , 0 , &new_pte[i] );
+  }
+
+  address &= ~LARGE_PAGE_MASK;
+  vmm_rmap_link( &pool , PTE_PAGE_PFN(new_pte) , address_space , address , NULL );
+  vmm_rmap_remove( pde->ADDRESS , address_space , address , NULL );
+
+  pde->_PAGE_SIZE = 0;
+  pde->RW         = 1;
+  pde->ADDRESS    = (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
+
+  vmm_tlb_flush_all( address_space );
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_unshare_large_page
+ *  @brief     This function makes a copy on write 4MB page writable.
+ *             The last owner keeps it whole; otherwise it is split and
+ *             its 4K pages are copied on write one by one
+ *  @param     address_space - pointer to the task's VM
+ *  @param     address       - user address inside the 4MB page
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM on failure
+ */
+
+KERN_RET_CODE vmm_unshare_large_page(struct task_vm *address_space,
+				     uint32_t address)
+{
+  PDE *pde;
+  int  i;
+
+  pde = vmm_get_pde( address_space , address );
+  assert( PDE_IS_LARGE(pde) );
+  if( pde->RW )
+    return KERN_SUCCESS;
+
+  for(i=0 ; i < PTE_PER_PAGE ; i++)
+    if( 1 != kernel_vmm.m_pages[pde->ADDRESS + i].refcount )
+      return vmm_split_large_page( address_space , address );
+
+  pde->RW = 1;
+  vmm_tlb_flush_page( address_space , address );
+  return KERN_SUCCESS;
+}
+
+
 //-- Address space manipulations                     --//
 //-- Ranges need to start and end at page boundaries --//
 //-- Input task_vm with atleast PDBR                 --//
@@ -355,7 +979,6 @@ KERN_RET_CODE vmm_install_range(struct task_vm *address_space,
   KERN_RET_CODE ret;
   unsigned long range_end;
   vm_range      *new_range=NULL;
-  PTE           *new_pte=NULL;
   int pages_nr;
   int i;
   FN_ENTRY();
@@ -382,18 +1005,34 @@ KERN_RET_CODE vmm_install_range(struct task_vm *address_space,
 
 
   //-- allocate the range structure --//
-  new_range = malloc(sizeof(*range));
+  new_range = vmm_cache_alloc(&kernel_vmm.range_cache);
   if(!new_range)
     return KERN_NO_MEM;
 
   //-- Insert the range on to the list of available ranges --//
   new_range->start = range->start;
   new_range->len   = range->len;
+  new_range->fault_around = VMM_FAULT_AROUND_PAGES;
+  new_range->flags = range->flags;
+  new_range->file_bytes = range->file_bytes;
+  new_range->file_start = range->file_start;
+  new_range->file_len   = range->file_len;
+  new_range->image      = range->image;
+  new_range->grow_floor  = range->grow_floor;
+  new_range->grow_window = range->grow_window;
+  new_range->shm = range->shm;
+  if( new_range->shm )
+    vmm_shm_get( new_range->shm );
   Q_INIT_ELEM( new_range , vm_range_next);
   Q_INSERT_FRONT( &address_space->vm_ranges_head ,
 		  new_range ,
 		  vm_range_next );
+  vmm_range_tree_insert( address_space , new_range );
+
 
+  //-- large ranges get their PDEs from vmm_install_large_range --//
+  if( new_range->flags & VM_RANGE_LARGE )
+    return KERN_SUCCESS;
 
   //-- PDE has to be installed always because its create using
   //-- vmm_init_task_vm()
@@ -401,56 +1040,27 @@ KERN_RET_CODE vmm_install_range(struct task_vm *address_space,
   assert(pages_nr);
 
   //-- Install the missing PTE ranges --//
+  //-- protection bits are set up by the caller using vmm_set_range_attr --//
   for( i = 0 ; i < pages_nr ; i++ )  {
-    LINEAR_ADDRESS_BREAKER linear_address;
-    linear_address.address = range->start + (i * PAGE_SIZE);
-
-    //-- Install the PTE entryin PDE if its not already --//
-    if(!address_space->pde_base[linear_address.u.PDE_IDX].PRESENT) {
-        new_pte = smemalign( PAGE_SIZE , PAGE_SIZE );
-	if(!new_pte) {
-	  ret = KERN_NO_MEM;
-	  goto error;
-	}
-	memset( new_pte , 0 , PAGE_SIZE );
-
-	//-- set up the entry in PDE --//
-	//-- this function sets up the tables and does not cares about
-	//-- protection bits caller must set it up using VMM_get_pte
-	address_space->pde_base[linear_address.u.PDE_IDX].PRESENT = 1;
-	address_space->pde_base[linear_address.u.PDE_IDX].ADDRESS =
-	  (unsigned long)new_pte >> PAGING_PAGE_OFFSET_BITS;
-    }
+    ret = vmm_install_pte_page( address_space , range->start + (i * PAGE_SIZE) );
+    if( KERN_SUCCESS != ret )
+      goto error;
   }
 
   return KERN_SUCCESS;
 
 error:
-  if( new_pte )
-    sfree(new_pte,PAGE_SIZE);
-
   assert( new_range );
+  vmm_range_tree_remove( address_space , new_range );
   Q_REMOVE( &address_space->vm_ranges_head ,
 	    new_range ,
 	    vm_range_next );
-  free(new_range);
+  range_free(new_range);
 
    FN_LEAVE();
   return ret;
 }
 
-/** @function  invalidate_tlb
- *  @brief     This function invalidates the tlb using the asm INVLPG instruction
- *  @param     addr - faulting address requiring action
- *  @return    void
- */
-
-static inline void invalidate_tlb(unsigned long addr)
-{
-        asm volatile("invlpg (%0)" ::"r" (addr) : "memory");
-}
-
-
 /** @function  vmm_uninstall_range
  *  @brief     This function is used to uninstall
  *             the supplied range from the task's VM
@@ -463,56 +1073,158 @@ static inline void invalidate_tlb(unsigned long addr)
 KERN_RET_CODE vmm_uninstall_range(struct task_vm *address_space,
 				  vm_range *range)
 {
+  PDE *pde;
   PTE *pte;
   unsigned long linear_address;
   vm_range *vmrange_ptr;
+  tlb_batch batch;
   FN_ENTRY();
 
-  Q_FOREACH( vmrange_ptr , &address_space->vm_ranges_head , vm_range_next )  {
-
-    if(vmrange_ptr == &address_space->vm_range_kernel)
-      continue;
-
-    if(vmrange_ptr->start == range->start &&
-       vmrange_ptr->len == range->len)
-      break;
-  }
+  vmrange_ptr = vmm_range_tree_find_start( address_space , range->start );
 
   //-- we don't have info about the range to be unmapped --//
-  if(!vmrange_ptr || vmrange_ptr->start != range->start) {
+  if(!vmrange_ptr || vmrange_ptr->len != range->len) {
     return KERN_ERROR_ADDRESS_NOT_PRESENT;
   }
 
 
   //-- unback all the pages pointed to by this VM range -//
+  vmm_tlb_batch_init(&batch,address_space);
   for(linear_address = vmrange_ptr->start;
       linear_address < (vmrange_ptr->start + vmrange_ptr->len);
       linear_address += PAGE_SIZE) {
 
+    //-- large pages are dropped a whole PDE at a time; --//
+    //-- a large range that failed to back has no PDEs  --//
+    pde = vmm_get_pde(address_space,linear_address);
+    if(PDE_IS_LARGE(pde) ||
+       (!pde->PRESENT && (vmrange_ptr->flags & VM_RANGE_LARGE))) {
+      if(pde->PRESENT)
+	large_page_release(address_space,pde,linear_address);
+      linear_address += LARGE_PAGE_SIZE - PAGE_SIZE;
+      continue;
+    }
+
     pte = vmm_get_pte(address_space,linear_address);
     assert(pte);
 
-    if(pte->PRESENT) {
-      pte->PRESENT = 0;
-      vmm_putref_user_page(pte->ADDRESS);
+    if(pte->PRESENT || PTE_IS_SWAPPED(pte)) {
+      //-- page tables shared after fork are copied before edits --//
+      if(KERN_SUCCESS != vmm_unshare_pte_page(address_space,linear_address)) {
+	vmm_tlb_batch_flush(&batch);
+	return KERN_NO_MEM;
+      }
+      pte = vmm_get_pte(address_space,linear_address);
+
+      if(PTE_IS_SWAPPED(pte))
+	vmm_swap_put(pte->ADDRESS);
+      else {
+	vmm_rmap_remove(pte->ADDRESS,NULL,0,pte);
+	pte->PRESENT = 0;
+	vmm_tlb_batch_add(&batch,linear_address,pte->ADDRESS);
+      }
+      pte->AVAIL   = 0;
       pte->ADDRESS = 0;
-      invalidate_tlb(linear_address);
     }
 
   }
+  vmm_tlb_batch_flush(&batch);
 
 
   //- Free book keeping information -//
+  vmm_range_tree_remove( address_space , vmrange_ptr );
   Q_REMOVE(&address_space->vm_ranges_head,
 	   vmrange_ptr,
 	   vm_range_next);
-  free(vmrange_ptr);
+  range_free(vmrange_ptr);
 
   FN_LEAVE();
   return KERN_SUCCESS;
 }
 
 
+/** @function  vmm_drop_pages
+ *  @brief     This function gives back the frames behind part of a user
+ *             range. The pages stay in the range; the next touch finds
+ *             them zero filled, or filled from the program image again.
+ *             Pages of a shared memory segment keep their bytes; only
+ *             this task's mappings of them go
+ *  @param     address_space - pointer to the task's VM
+ *  @param     start         - page aligned user address inside a range
+ *  @param     len           - length in bytes; a multiple of PAGE_SIZE
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when a page table
+ *             shared after fork or a 4MB page could not be split - the
+ *             pages before it are dropped
+ */
+
+KERN_RET_CODE vmm_drop_pages(struct task_vm *address_space,
+			     unsigned long start,
+			     unsigned long len)
+{
+  PDE *pde;
+  PTE *pte;
+  unsigned long linear_address;
+  unsigned long last;
+  KERN_RET_CODE ret = KERN_SUCCESS;
+  tlb_batch batch;
+
+  //-- last page rather than end; stops inside the span even --//
+  //-- if the caller's end would wrap to 0                    --//
+  last = start + len - PAGE_SIZE;
+
+  vmm_tlb_batch_init(&batch,address_space);
+  for(linear_address = start ; ; linear_address += PAGE_SIZE) {
+    pde = vmm_get_pde(address_space,linear_address);
+
+    //-- a whole 4MB page goes at once; a table comes back on demand --//
+    if(PDE_IS_LARGE(pde)) {
+      if(!(linear_address & LARGE_PAGE_MASK) &&
+	 last - linear_address >= LARGE_PAGE_SIZE - PAGE_SIZE) {
+	large_page_release(address_space,pde,linear_address);
+	linear_address += LARGE_PAGE_SIZE - PAGE_SIZE;
+	goto next;
+      }
+      ret = vmm_split_large_page(address_space,linear_address);
+      if(KERN_SUCCESS != ret)
+	break;
+    }
+
+    //-- nothing was ever backed in this 4MB --//
+    if(!pde->PRESENT) {
+      linear_address |= LARGE_PAGE_MASK & ~PAGE_MASK;
+      goto next;
+    }
+
+    pte = vmm_get_pte(address_space,linear_address);
+    if(pte->PRESENT || PTE_IS_SWAPPED(pte)) {
+      //-- same as vmm_uninstall_range, minus the range --//
+      ret = vmm_unshare_pte_page(address_space,linear_address);
+      if(KERN_SUCCESS != ret)
+	break;
+      pte = vmm_get_pte(address_space,linear_address);
+
+      if(PTE_IS_SWAPPED(pte))
+	vmm_swap_put(pte->ADDRESS);
+      else {
+	vmm_rmap_remove(pte->ADDRESS,NULL,0,pte);
+	pte->PRESENT = 0;
+	vmm_tlb_batch_add(&batch,linear_address,pte->ADDRESS);
+      }
+      pte->AVAIL   = 0;
+      pte->ADDRESS = 0;
+      kernel_vmm.dropped_pages++;
+    }
+
+  next:
+    if(linear_address >= last)
+      break;
+  }
+  vmm_tlb_batch_flush(&batch);
+
+  return ret;
+}
+
+
 //-- WE don't have an corresponding free kernel mod pte --//
 //-- because we never do that                           --//
 
@@ -558,12 +1270,16 @@ KERN_RET_CODE vmm_free_user_ptes( struct task_vm *address_space )
   la.address = address;
 
   for(i=la.u.PDE_IDX ; i  < 1024 ; i++) {
-    if(address_space->pde_base[i].PRESENT) {
-      unsigned long pte_addr;
-      pte_addr = (unsigned long) address_space->pde_base[i].ADDRESS <<  PAGING_PAGE_OFFSET_BITS;
+    //- large pages own no table; vmm_unback_all_user_ranges drops them -//
+    if(PDE_IS_LARGE(&address_space->pde_base[i]))
+      continue;
 
-      sfree((char *) pte_addr,
-	    PAGE_SIZE);
+    if(address_space->pde_base[i].PRESENT) {
+      vmm_rmap_remove(PTE_PAGE_PFN(PDE_PTE_PAGE(&address_space->pde_base[i])),
+		      address_space,
+		      i * LARGE_PAGE_SIZE,
+		      NULL);
+      vmm_putref_pte_page(PDE_PTE_PAGE(&address_space->pde_base[i]));
       address_space->pde_base[i].ADDRESS = 0;
       address_space->pde_base[i].PRESENT = 0;
     }
@@ -578,7 +1294,8 @@ KERN_RET_CODE vmm_free_user_ptes( struct task_vm *address_space )
  *             when accessing the giver user address
  *  @param     address_space - pointer to task's VM
  *  @param     address       - the userland address in question
- *  @return    pointer to the PTE
+ *  @return    pointer to the PTE; NULL if there is no page table or
+ *             the address is mapped by a 4MB page (see PDE_IS_LARGE)
  */
 
 PTE *vmm_get_pte( struct task_vm *address_space , uint32_t address )
@@ -589,6 +1306,11 @@ PTE *vmm_get_pte( struct task_vm *address_space , uint32_t address )
     linear_address.address = address;
 
     assert(address_space->pde_base);
+    if(PDE_IS_LARGE(&address_space->pde_base[linear_address.u.PDE_IDX])) {
+      FN_LEAVE();
+      return NULL;
+    }
+
     if(address_space->pde_base[linear_address.u.PDE_IDX].PRESENT) {
       PTE *pte_page = (PTE *)
 	(unsigned long) address_space->pde_base[linear_address.u.PDE_IDX].ADDRESS;
@@ -657,6 +1379,8 @@ KERN_RET_CODE vmm_share_physical_range(struct task_vm *vm_dst,
     }
 
     //- make dst share the physical page as source -//
+    if(KERN_SUCCESS != vmm_rmap_add(src_pte->ADDRESS,NULL,0,dst_pte))
+      return KERN_NO_MEM;
     vmm_getref_user_page(src_pte->ADDRESS);
     dst_pte->ADDRESS = src_pte->ADDRESS;
   }
@@ -666,7 +1390,7 @@ KERN_RET_CODE vmm_share_physical_range(struct task_vm *vm_dst,
 
 /** @function  vmm_back_all_user_ranges
  *  @brief     This function will back the task's user VM ranges
- *             by allocating frames and setting PTE/PDE entries
+ *             by allocating zeroed frames and setting PTE/PDE entries
  *  @param     vm - pointer to task's VM
  *  @return    KERN_SUCCESS on completion
  */
@@ -689,8 +1413,15 @@ KERN_RET_CODE vmm_back_all_user_ranges(struct task_vm *vm) {
 
       pte = vmm_get_pte(vm,linear_address);
       assert(pte);
-      if(KERN_SUCCESS != vmm_get_free_user_pages(&pfn))
+      //- ranges may share a page -//
+      if(pte->PRESENT)
+	continue;
+      if(KERN_SUCCESS != vmm_get_zeroed_user_page(&pfn))
+	return KERN_NO_MEM;
+      if(KERN_SUCCESS != vmm_rmap_add(pfn,NULL,0,pte)) {
+	vmm_putref_user_page(pfn);
 	return KERN_NO_MEM;
+      }
 
       pte->PRESENT = 1;
       pte->ADDRESS = pfn;
@@ -710,32 +1441,48 @@ KERN_RET_CODE vmm_back_all_user_ranges(struct task_vm *vm) {
 
 KERN_RET_CODE vmm_unback_all_user_ranges(struct task_vm *vm)
 {
-  vm_range *this_range;
-  uint32_t linear_address;
-  PTE *pte;
+  int i,j;
+  PDE *pde;
+  PTE *pte_page;
+  LINEAR_ADDRESS_BREAKER la;
+  la.address = USER_MEM_START;
 
-  Q_FOREACH( this_range , &vm->vm_ranges_head ,vm_range_next ) {
-    //- Skip the kernel range -//
-    if(this_range == &vm->vm_range_kernel)
+  //-- walk the page tables rather than the ranges; ranges can     --//
+  //-- overlap and a page table shared after fork is not ours alone --//
+  for(i=la.u.PDE_IDX ; i < PTE_PER_PAGE ; i++) {
+    pde = &vm->pde_base[i];
+    if(!pde->PRESENT)
       continue;
 
-    //-- unmap pages --//
-    for(linear_address = (uint32_t)this_range->start;
-	linear_address < (uint32_t)(this_range->start + this_range->len);
-	linear_address += PAGE_SIZE) {
-      pte = vmm_get_pte(vm,linear_address);
-      assert(pte);
+    if(pde->_PAGE_SIZE) {
+      large_page_release(vm,pde,i * LARGE_PAGE_SIZE);
+      continue;
+    }
 
-      // -- we have this check because vm ranges abstraction can overlap -- //
-      // -- so some pages might be dereferenced earlier -- //
-      // --and thier PTE->address set to 0 -- //
-      if(pte->ADDRESS)
-	vmm_putref_user_page(pte->ADDRESS);
+    pte_page = PDE_PTE_PAGE(pde);
+    if(kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].refcount > 1) {
+      //- the other sharers keep the frames -//
+      vmm_rmap_remove(PTE_PAGE_PFN(pte_page),vm,i * LARGE_PAGE_SIZE,NULL);
+      vmm_putref_pte_page(pte_page);
+      pde->PRESENT = 0;
+      pde->ADDRESS = 0;
+      continue;
+    }
 
-      pte->PRESENT = 0;
-      pte->ADDRESS = 0;
-    }//--end 1 range --//
-  }//-- End all range
+    //-- unmap pages --//
+    for(j=0 ; j < PTE_PER_PAGE ; j++) {
+      if(pte_page[j].PRESENT) {
+	vmm_rmap_remove(pte_page[j].ADDRESS,NULL,0,&pte_page[j]);
+	vmm_putref_user_page(pte_page[j].ADDRESS);
+      }
+      else if(PTE_IS_SWAPPED(&pte_page[j]))
+	vmm_swap_put(pte_page[j].ADDRESS);
+
+      pte_page[j].PRESENT = 0;
+      pte_page[j].AVAIL   = 0;
+      pte_page[j].ADDRESS = 0;
+    }
+  }
 
   return KERN_SUCCESS;
 }
@@ -743,7 +1490,8 @@ KERN_RET_CODE vmm_unback_all_user_ranges(struct task_vm *vm)
 
 /** @function  vmm_set_range_attr
  *  @brief     This function will set the supplied attributes
- *             to all user pages (in PDE/PTEs)
+ *             to all user pages (in PDE/PTEs). Pages without a frame
+ *             stay not present; they are backed on first touch
  *  @param     vm    - pointer to task's VM
  *  @param     range - pointer to vm_range whose attr must be set
  *  @param     attrs - the attribute values that are to be set
@@ -755,30 +1503,40 @@ KERN_RET_CODE vmm_set_range_attr(struct task_vm  *vm,
 				 PDE    attrs)
 {
   unsigned long linear_address;
-  PDE *pde;
   PTE *pte;
   PTE temp;
+  tlb_batch batch;
 
   attrs.ADDRESS = -1;
 
+  //-- PDEs stay writable; shared page tables are copied first --//
+  //-- so that running out of memory leaves the range untouched --//
+  //-- 4MB pages are split since protection is set per page     --//
+  for(linear_address = range->start;
+      linear_address < range->start + range->len;
+      linear_address += PAGE_SIZE) {
+    if(PDE_IS_LARGE(vmm_get_pde(vm,linear_address)) &&
+       KERN_SUCCESS != vmm_split_large_page(vm,linear_address))
+      return KERN_NO_MEM;
+    if(KERN_SUCCESS != vmm_unshare_pte_page(vm,linear_address))
+      return KERN_NO_MEM;
+  }
+
+  vmm_tlb_batch_init(&batch,vm);
   for(linear_address = range->start;
       linear_address < range->start + range->len;
       linear_address += PAGE_SIZE) {
 
     pte = vmm_get_pte(vm,linear_address);
     assert(pte);
-    temp.ADDRESS = pte->ADDRESS;
+    temp = *pte;
     *pte = attrs;
     pte->ADDRESS = temp.ADDRESS;
-
-
-
-    pde = vmm_get_pde(vm,linear_address);
-    assert(pde);
-    temp.ADDRESS = pde->ADDRESS;
-    *pde = attrs;
-    pde->ADDRESS = temp.ADDRESS;
+    pte->AVAIL   = temp.AVAIL;     //- swapped out pages stay swapped out -//
+    pte->PRESENT = attrs.PRESENT && temp.PRESENT;
+    vmm_tlb_batch_add(&batch,linear_address,PFN_NULL);
   }//--end 1 range --//
+  vmm_tlb_batch_flush(&batch);
 
   return KERN_SUCCESS;
 }
@@ -809,8 +1567,9 @@ KERN_RET_CODE vmm_copy_vmranges_struct(struct task_vm *vm_dst,
     Q_REMOVE(&vm_dst->vm_ranges_head,
 	     vmrange_ptr,
 	     vm_range_next);
-    free(vmrange_ptr);
+    range_free(vmrange_ptr);
   }
+  vm_dst->vm_range_root = NULL;
 
   //-- allocated and copy over the ranges  --//
   Q_FOREACH( vmrange_ptr , &vm_src->vm_ranges_head , vm_range_next )  {
@@ -818,17 +1577,29 @@ KERN_RET_CODE vmm_copy_vmranges_struct(struct task_vm *vm_dst,
       continue;
 
     //-- allocate the range structure --//
-    new_range = malloc(sizeof(*new_range));
+    new_range = vmm_cache_alloc(&kernel_vmm.range_cache);
     if(!new_range)
       return KERN_NO_MEM;
 
     //-- Insert the range on to the list of available ranges --//
     new_range->start = vmrange_ptr->start;
     new_range->len   = vmrange_ptr->len;
+    new_range->fault_around = vmrange_ptr->fault_around;
+    new_range->flags = vmrange_ptr->flags;
+    new_range->file_bytes = vmrange_ptr->file_bytes;
+    new_range->file_start = vmrange_ptr->file_start;
+    new_range->file_len   = vmrange_ptr->file_len;
+    new_range->image      = vmrange_ptr->image;
+    new_range->grow_floor  = vmrange_ptr->grow_floor;
+    new_range->grow_window = vmrange_ptr->grow_window;
+    new_range->shm = vmrange_ptr->shm;
+    if( new_range->shm )
+      vmm_shm_get( new_range->shm );
     Q_INIT_ELEM( new_range , vm_range_next );
     Q_INSERT_TAIL( &vm_dst->vm_ranges_head ,
 		    new_range ,
 		    vm_range_next );
+    vmm_range_tree_insert( vm_dst , new_range );
 
   }
 
@@ -858,26 +1629,104 @@ KERN_RET_CODE vmm_copy_vmranges_struct(struct task_vm *vm_dst,
  */
 
 vm_range *vmm_get_range( struct task_vm *vm , char *address ) {
+  return vmm_range_tree_lookup( vm , (unsigned long)address );
+}
 
-  vm_range *vmrange_ptr;
-  FN_ENTRY();
 
-  Q_FOREACH( vmrange_ptr , &vm->vm_ranges_head , vm_range_next )  {
+/** @function  vmm_get_overlapping_range
+ *  @brief     This function finds a user range that overlaps the supplied range
+ *  @param     vm        - pointer to the task's VM
+ *  @param     base_addr - user address in question
+ *  @param     len       - length of range starting at base_addr
+ *  @return    pointer to the lowest overlapping vm_range; NULL if none
+ */
+
+vm_range *vmm_get_overlapping_range( struct task_vm *vm , void *base_addr , int len ) {
+  return vmm_range_tree_overlap( vm ,
+				 (unsigned long)base_addr ,
+				 (unsigned long)base_addr + len );
+}
 
-    if(vmrange_ptr == &vm->vm_range_kernel)
-      continue;
 
-    if( ( address >= (char *)(vmrange_ptr->start) )
-	&&( address < (char *)(vmrange_ptr->start + vmrange_ptr->len) ) ) {
-      FN_LEAVE();
-      return vmrange_ptr;
-    }
+/** @function  vmm_get_growable_range
+ *  @brief     This function finds the stack whose growth window holds an
+ *             address just below it
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address outside of any range
+ *  @return    the growable range; NULL if none is close enough
+ */
+
+vm_range *vmm_get_growable_range( struct task_vm *vm , unsigned long address ) {
+  vm_range     *range;
+  unsigned long end;
+
+  end = address + VMM_STACK_WINDOW_PAGES * PAGE_SIZE;
+  if( end < address )
+    end = ~0UL;
+
+  //-- the first range above the address, if it is near enough --//
+  range = vmm_range_tree_overlap( vm , address , end );
+  if( NULL == range || !(range->flags & VM_RANGE_GROWSDOWN) ||
+      range->start <= address ||
+      range->start - address > (unsigned long)range->grow_window * PAGE_SIZE )
+    return NULL;
+
+  return range;
+}
+
+
+/** @function  vmm_grow_range
+ *  @brief     This function grows a stack down over a faulting address,
+ *             by at least VMM_STACK_GROW_PAGES pages. The stack stays
+ *             above its floor and VMM_STACK_GUARD_PAGES away from the
+ *             range below it
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address in the growth window of a stack
+ *  @note      page tables for the new pages are installed when they fault
+ *  @return    KERN_SUCCESS when the address is now inside the stack;
+ *             KERN_ERROR_ADDRESS_NOT_PRESENT if it cannot grow that far
+ */
+
+KERN_RET_CODE vmm_grow_range( struct task_vm *vm , unsigned long address ) {
+  vm_range     *range;
+  unsigned long page = address & ~PAGE_MASK;
+  unsigned long guard = VMM_STACK_GUARD_PAGES * PAGE_SIZE;
+  unsigned long start;
+  uint32_t      eflags;
+
+  //-- another thread may grow it or map below it meanwhile --//
+  eflags = disable_preemption();
+  range = vmm_get_growable_range( vm , address );
+  if( NULL == range || page < range->grow_floor ||
+      page < USER_MEM_START + guard ) {
+    enable_preemption(eflags);
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
   }
 
-  FN_LEAVE();
-  return NULL;
+  //-- a whole step if it fits, else just down to the fault --//
+  start = range->start - VMM_STACK_GROW_PAGES * PAGE_SIZE;
+  if( start > page || start < range->grow_floor ||
+      start < USER_MEM_START + guard ||
+      vmm_range_tree_overlap( vm , start - guard , range->start ) )
+    start = page;
+
+  if( vmm_range_tree_overlap( vm , start - guard , range->start ) ) {
+    enable_preemption(eflags);
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+  }
+
+  //-- the range is keyed by start in the range tree --//
+  if( vm->vm_stack_start == range->start ) {
+    vm->vm_stack_len  += vm->vm_stack_start - start;
+    vm->vm_stack_start = start;
+  }
+  vmm_range_tree_resize( vm , range , start , range->len + (range->start - start) );
+  enable_preemption(eflags);
+
+  return KERN_SUCCESS;
 }
 
+
 /** @function  vmm_is_range_present
  *  @brief     This function checks whether the supplied user range
  *             is already a part of the user VM or not
@@ -889,29 +1738,26 @@ vm_range *vmm_get_range( struct task_vm *vm , char *address ) {
 
 KERN_RET_CODE vmm_is_range_present( struct task_vm *vm , void *base_addr , int len ) {
   vm_range *vmrange_ptr;
-  char *next_addr = (char *)base_addr;
-  int offset;
+  unsigned long next_addr = (unsigned long)base_addr;
+  unsigned long end_addr  = (unsigned long)base_addr + len;
 
   FN_ENTRY();
 
-  while(1) {
-    vmrange_ptr = vmm_get_range( vm , next_addr );
+  if( len < 0 || end_addr < next_addr )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+  //-- walk the ranges covering the request back to back --//
+  do {
+    vmrange_ptr = vmm_range_tree_lookup( vm , next_addr );
     if( NULL == vmrange_ptr ) /* -- outside vm_range -- */ {
       return KERN_ERROR_ADDRESS_NOT_PRESENT;
     }
 
-    offset = (int)( vmrange_ptr->start + vmrange_ptr->len  - (unsigned long) next_addr);
-
-    if( len <= offset ) /* -- within single vm_range -- */ {
-      return KERN_SUCCESS;
-    }
-
-    next_addr = next_addr + offset;
-
-  }
+    next_addr = vmrange_ptr->start + vmrange_ptr->len;
+  } while( next_addr < end_addr );
 
   FN_LEAVE();
-  return KERN_ERROR_UNIMPLEMENTED;
+  return KERN_SUCCESS;
 }
 
 int  vmm_is_address_ro( struct task_vm *vm , void *base_addr ) {
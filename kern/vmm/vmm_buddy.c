@@ -0,0 +1,388 @@
+/** @file     vmm_buddy.c
+ *  @brief    This file contains the binary buddy allocator for user frames
+ *
+ *            Frames from USER_FIRST_PFN to the end of physical memory are
+ *            kept in per order free lists. A block of order N is
+ *            ORDER_PAGES(N) frames and always starts at a PFN that is a
+ *            multiple of ORDER_PAGES(N), so the buddy of a block is found
+ *            by flipping bit N of its PFN.
+ *
+ *            Every frame of an allocated block carries its own refcount.
+ *            When the last reference to a frame is dropped the frame is
+ *            freed as an order 0 block and coalesced with its buddies,
+ *            so blocks handed out at a high order can be released frame
+ *            by frame (COW, remove_pages) and still come back together.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+//-- frames past this are the swap RAM disk; see vmm_swap_init --//
+#define BUDDY_END_PFN  (kernel_vmm.swap_disk_base)
+
+#define BUDDY_OF(pfn,order)  ((pfn) ^ ORDER_PAGES(order))
+
+
+/** @function  buddy_list_add
+ *  @brief     This function puts a block head on the free list of its order
+ *  @param     pfn   - first frame of the block
+ *  @param     order - order of the block
+ *  @return    void
+ */
+
+static void buddy_list_add(PFN pfn,int order) {
+  m_page *page = &kernel_vmm.m_pages[pfn];
+  buddy_free_area *area = &kernel_vmm.free_area[order];
+
+  page->flags |= M_PAGE_BUDDY_FREE;
+  page->order  = order;
+  page->prev   = PFN_NULL;
+  page->next   = area->head;
+  if( PFN_NULL != area->head )
+    kernel_vmm.m_pages[area->head].prev = pfn;
+  area->head = pfn;
+  area->nr_free++;
+}
+
+
+/** @function  buddy_list_del
+ *  @brief     This function takes a block head off the free list of its order
+ *  @param     pfn   - first frame of the block
+ *  @return    void
+ */
+
+static void buddy_list_del(PFN pfn) {
+  m_page *page = &kernel_vmm.m_pages[pfn];
+  buddy_free_area *area = &kernel_vmm.free_area[page->order];
+
+  assert( page->flags & M_PAGE_BUDDY_FREE );
+  if( PFN_NULL != page->prev )
+    kernel_vmm.m_pages[page->prev].next = page->next;
+  else
+    area->head = page->next;
+
+  if( PFN_NULL != page->next )
+    kernel_vmm.m_pages[page->next].prev = page->prev;
+
+  page->flags &= ~M_PAGE_BUDDY_FREE;
+  page->next   = PFN_NULL;
+  page->prev   = PFN_NULL;
+  area->nr_free--;
+}
+
+
+/** @function  buddy_is_free_block
+ *  @brief     This function checks if a PFN heads a free block of an order
+ *  @param     pfn   - frame to check
+ *  @param     order - expected order of the free block
+ *  @return    1 if the block is free; 0 otherwise
+ */
+
+static int buddy_is_free_block(PFN pfn,int order) {
+  //-- buddies outside the user frame range are never free --//
+  if( pfn < USER_FIRST_PFN )
+    return 0;
+  if( pfn + ORDER_PAGES(order) > BUDDY_END_PFN )
+    return 0;
+
+  return ( kernel_vmm.m_pages[pfn].flags & M_PAGE_BUDDY_FREE ) &&
+    ( kernel_vmm.m_pages[pfn].order == order );
+}
+
+
+/** @function  buddy_free_block
+ *  @brief     This function returns a block to the free lists merging
+ *             it with its buddy as long as the buddy is free
+ *  @param     pfn   - first frame of the block
+ *  @param     order - order of the block
+ *  @note      called with preemption disabled
+ *  @return    void
+ */
+
+static void buddy_free_block(PFN pfn,int order) {
+  PFN buddy;
+
+  kernel_vmm.nr_free_pages += ORDER_PAGES(order);
+
+  while( order < VMM_BUDDY_MAX_ORDER ) {
+    buddy = BUDDY_OF(pfn,order);
+    if( !buddy_is_free_block(buddy,order) )
+      break;
+
+    //-- coalesce with the buddy; the lower half heads the merged block --//
+    buddy_list_del(buddy);
+    if( buddy < pfn )
+      pfn = buddy;
+    order++;
+  }
+
+  buddy_list_add(pfn,order);
+}
+
+
+/** @function  vmm_buddy_init
+ *  @brief     This function puts all the user frames on the buddy free lists
+ *             carving them into the largest naturally aligned blocks
+ *  @note      kernel_vmm.m_pages has to be allocated and zeroed and
+ *             vmm_swap_init has to have set aside the RAM disk
+ *  @return    void
+ */
+
+void vmm_buddy_init(void) {
+  PFN pfn;
+  int order;
+
+  for(order = 0; order < VMM_BUDDY_ORDERS; order++) {
+    kernel_vmm.free_area[order].head    = PFN_NULL;
+    kernel_vmm.free_area[order].nr_free = 0;
+  }
+
+  kernel_vmm.nr_free_pages = 0;
+  kernel_vmm.nr_user_pages = BUDDY_END_PFN - USER_FIRST_PFN;
+
+  pfn = USER_FIRST_PFN;
+  while( pfn < BUDDY_END_PFN ) {
+    //-- largest block aligned at pfn that fits in memory --//
+    order = VMM_BUDDY_MAX_ORDER;
+    while( (pfn & (ORDER_PAGES(order) - 1)) ||
+	   pfn + ORDER_PAGES(order) > BUDDY_END_PFN )
+      order--;
+
+    buddy_free_block(pfn,order);
+    pfn += ORDER_PAGES(order);
+  }
+
+  DUMP("vmm_buddy_init 0x%x user frames on the free lists",
+       kernel_vmm.nr_free_pages);
+}
+
+
+/** @function  vmm_alloc_user_pages
+ *  @brief     This function is used to get a physically contiguous
+ *             block of ORDER_PAGES(order) user frames
+ *  @param     order - log2 of the number of frames needed
+ *  @param     pfn   - pointer to first frame number holder
+ *  @return    KERN_SUCCESS on successful get; else KERN_NO_MEM
+ */
+
+KERN_RET_CODE vmm_alloc_user_pages(int order,PFN *pfn) {
+  uint32_t eflags;
+  PFN      block;
+  int      i;
+  int      current_order;
+
+  if( order < 0 || order > VMM_BUDDY_MAX_ORDER )
+    return KERN_ERROR_GENERIC;
+
+  eflags = disable_preemption();
+
+  //-- smallest order with a free block --//
+  for(current_order = order; current_order < VMM_BUDDY_ORDERS; current_order++)
+    if( PFN_NULL != kernel_vmm.free_area[current_order].head )
+      break;
+
+  if( current_order == VMM_BUDDY_ORDERS ) {
+    enable_preemption(eflags);
+    return KERN_NO_MEM;
+  }
+
+  block = kernel_vmm.free_area[current_order].head;
+  buddy_list_del(block);
+
+  //-- split; the upper halves go back to the free lists --//
+  while( current_order > order ) {
+    current_order--;
+    buddy_list_add(block + ORDER_PAGES(current_order),current_order);
+  }
+
+  kernel_vmm.nr_free_pages -= ORDER_PAGES(order);
+  kernel_vmm.m_pages[block].order = order;
+  for(i = 0; i < ORDER_PAGES(order); i++) {
+    assert( kernel_vmm.m_pages[block + i].refcount == 0 );
+    kernel_vmm.m_pages[block + i].refcount = 1;
+  }
+  enable_preemption(eflags);
+
+  *pfn = block;
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_free_user_pages
+ *  @brief     This function drops the allocation reference on each
+ *             frame of a block got from vmm_alloc_user_pages
+ *  @param     pfn   - first frame of the block
+ *  @param     order - order the block was allocated with
+ *  @return    void
+ */
+
+void vmm_free_user_pages(PFN pfn,int order) {
+  int i;
+
+  for(i = 0; i < ORDER_PAGES(order); i++)
+    vmm_putref_user_page(pfn + i);
+}
+
+
+/** @function  vmm_get_free_user_pages
+ *  @brief     This function is used to get user page frames
+ *  @param     pfn - pointer to frame number holder
+ *  @return    KERN_SUCCESS on successful get; else KERN_NO_MEM
+ */
+
+KERN_RET_CODE vmm_get_free_user_pages(PFN *pfn) {
+  KERN_RET_CODE ret;
+
+  ret = vmm_alloc_user_pages(0,pfn);
+  if( KERN_NO_MEM != ret )
+    return ret;
+
+  //-- low on memory; frames parked in the zero pool are still free --//
+  //-- then program frames that only the image cache still holds    --//
+  //-- and last, frames nobody touched lately go to swap              --//
+  if( vmm_zero_pool_reclaim() || vmm_image_reclaim() ||
+      vmm_swap_reclaim(VMM_SWAP_BATCH) )
+    ret = vmm_alloc_user_pages(0,pfn);
+  return ret;
+}
+
+
+/** @function  vmm_getref_user_page
+ *  @brief     This function is used to increment refcount for a frame - share (COW)
+ *  @param     pfn - frame number holder
+ *  @return    void
+ */
+
+void vmm_getref_user_page(PFN pfn) {
+  assert(pfn < kernel_vmm.nr_physical_pages);
+  assert(pfn >= USER_FIRST_PFN);
+
+  assert(kernel_vmm.m_pages[pfn].refcount >= 1);
+  // -- there is one reference from getfreepages -- //
+
+  kernel_vmm.m_pages[pfn].refcount++;
+}
+
+
+/** @function  vmm_putref_user_page
+ *  @brief     This function is used to decrement refcount for a frame - unshare (COW)
+ *             The last reference gives the frame back to the buddy allocator
+ *  @param     pfn - frame number holder
+ *  @return    void
+ */
+
+void vmm_putref_user_page(PFN pfn) {
+  uint32_t eflags;
+
+  assert(pfn < kernel_vmm.nr_physical_pages);
+  assert(pfn >= USER_FIRST_PFN);
+
+  eflags = disable_preemption();
+  kernel_vmm.m_pages[pfn].refcount--;
+  assert(kernel_vmm.m_pages[pfn].refcount >= 0);
+
+  if(0 == kernel_vmm.m_pages[pfn].refcount) {
+    assert(NULL == kernel_vmm.m_pages[pfn].rmap);
+    buddy_free_block(pfn,0);
+  }
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_nr_free_user_pages
+ *  @brief     This function returns the number of free user frames
+ *  @return    count of free user frames
+ */
+
+int vmm_nr_free_user_pages(void) {
+  return kernel_vmm.nr_free_pages;
+}
+
+
+/** @function  vmm_get_memstats
+ *  @brief     This function takes a snapshot of the frame pool
+ *             along with its fragmentation statistics
+ *  @param     stats - statistics block to fill in
+ *  @return    void
+ */
+
+void vmm_get_memstats(memstats_t *stats) {
+  uint32_t eflags;
+  int      order;
+  int      usable;
+
+  memset(stats,0,sizeof(*stats));
+
+  eflags = disable_preemption();
+  stats->nr_physical_frames = kernel_vmm.nr_physical_pages;
+  stats->nr_user_frames     = kernel_vmm.nr_user_pages;
+  stats->nr_free_frames     = kernel_vmm.nr_free_pages;
+  stats->largest_free_order = -1;
+  stats->zero_page_faults   = kernel_vmm.zero_page_maps;
+  stats->zero_page_breaks   = kernel_vmm.zero_page_breaks;
+  stats->zero_page_mapped   = kernel_vmm.m_pages[kernel_vmm.zero_pfn].refcount - 1;
+  stats->zero_pool_frames   = kernel_vmm.zero_pool_nr;
+  stats->zero_pool_hits     = kernel_vmm.zero_pool_hits;
+  stats->zero_pool_misses   = kernel_vmm.zero_pool_misses;
+  stats->fault_around_faults = kernel_vmm.fault_around_faults;
+  stats->fault_around_pages  = kernel_vmm.fault_around_pages;
+  stats->madvise_prefaulted  = kernel_vmm.prefaulted_pages;
+  stats->madvise_dropped     = kernel_vmm.dropped_pages;
+  stats->cow_copies          = kernel_vmm.cow_copies;
+  stats->cow_promotions      = kernel_vmm.cow_promotions;
+  stats->file_page_fills     = kernel_vmm.file_page_fills;
+  stats->image_cache_frames  = kernel_vmm.image_frames;
+  stats->image_cache_hits    = kernel_vmm.image_hits;
+  stats->image_cache_misses  = kernel_vmm.image_misses;
+  stats->image_cache_evictions = kernel_vmm.image_evictions;
+  stats->rmap_entries        = kernel_vmm.rmap_entries;
+  stats->swap_disk_slots     = kernel_vmm.swap_disk_pages;
+  stats->swap_disk_used      = kernel_vmm.swap_disk_used;
+  stats->swap_compressed_pages = kernel_vmm.swap_zpages;
+  stats->swap_compressed_bytes = kernel_vmm.swap_zbytes;
+  stats->swap_outs           = kernel_vmm.swap_outs;
+  stats->swap_ins            = kernel_vmm.swap_ins;
+  stats->swap_failures       = kernel_vmm.swap_failures;
+  stats->ksm_sweeps          = kernel_vmm.ksm_sweeps;
+  stats->ksm_merged_frames   = kernel_vmm.ksm_merges;
+  stats->ksm_zero_frames     = kernel_vmm.ksm_zero_merges;
+  stats->shm_segments        = kernel_vmm.shm_nr_segments;
+  stats->shm_frames          = kernel_vmm.shm_frames;
+  stats->shm_maps            = kernel_vmm.shm_maps;
+  vmm_cache_totals(stats);
+  stats->kstacks_reaped      = kernel_vmm.kstack_reaped;
+  stats->tlb_global          = kernel_vmm.tlb_global;
+  stats->tlb_invlpgs         = kernel_vmm.tlb_invlpgs;
+  stats->tlb_full_flushes    = kernel_vmm.tlb_full_flushes;
+  stats->tlb_skipped         = kernel_vmm.tlb_skipped;
+  stats->tlb_switches        = kernel_vmm.tlb_switches;
+  for(order = 0; order < VMM_BUDDY_ORDERS; order++) {
+    stats->free_blocks[order] = kernel_vmm.free_area[order].nr_free;
+    if( stats->free_blocks[order] )
+      stats->largest_free_order = order;
+  }
+  enable_preemption(eflags);
+
+  //-- free memory that is in blocks too small for an order is unusable --//
+  usable = 0;
+  for(order = VMM_BUDDY_MAX_ORDER; order >= 0; order--) {
+    usable += stats->free_blocks[order] * ORDER_PAGES(order);
+    if( stats->nr_free_frames )
+      stats->unusable_index[order] =
+	((stats->nr_free_frames - usable) * 100) / stats->nr_free_frames;
+    else
+      stats->unusable_index[order] = 100;
+  }
+}
@@ -0,0 +1,202 @@
+/** @file     vmm_cache.c
+ *  @brief    This file contains the object caches for fixed size kernel
+ *            objects
+ *
+ *            malloc goes through one semaphore and a first fit walk of
+ *            the lmm free list. The objects the kernel makes and drops
+ *            the most - range nodes, page tables, kernel stacks and exec
+ *            argument copies - have a fixed size, so each kind gets a
+ *            cache: a free list of objects of that size. Allocating and
+ *            freeing is a list push or pop with preemption disabled.
+ *
+ *            An empty cache grows by a slab, one smemalign carved into
+ *            several objects. The constructor runs once per object, when
+ *            it is carved; objects go back on the list in the state the
+ *            constructor left them in, except for their first word,
+ *            which links the list and reads as zero once handed out.
+ *            Past max_free objects, frees go back to lmm one object at a
+ *            time; lmm takes back any part of a block it handed out.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  vmm_cache_init
+ *  @brief     This function sets up an empty cache
+ *  @param     cache - cache to set up
+ *  @param     name  - shown by vmm_cache_dump
+ *  @param     size  - object size; at least a pointer
+ *  @param     align - object alignment; a power of 2 dividing size
+ *  @param     ctor  - called on each new object; may be NULL
+ *  @return    void
+ */
+
+void vmm_cache_init(vmm_cache *cache,
+		    const char *name,
+		    unsigned int size,
+		    unsigned int align,
+		    void (*ctor)(void *obj)) {
+  assert( size >= sizeof(void *) && 0 == size % align );
+
+  memset(cache,0,sizeof(*cache));
+  cache->name     = name;
+  cache->size     = size;
+  cache->align    = align;
+  cache->ctor     = ctor;
+  cache->per_slab = ( size >= PAGE_SIZE ) ? VMM_CACHE_BIG_OBJS : PAGE_SIZE / size;
+  cache->max_free = 2 * cache->per_slab;
+
+  cache->next = kernel_vmm.caches;
+  kernel_vmm.caches = cache;
+}
+
+
+/** @function  cache_grow
+ *  @brief     This function carves a new slab into objects and puts them
+ *             on the free list
+ *  @param     cache - cache that ran dry
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when out of memory
+ */
+
+static KERN_RET_CODE cache_grow(vmm_cache *cache) {
+  char    *slab;
+  uint32_t eflags;
+  int      i;
+
+  slab = smemalign(cache->align,cache->per_slab * cache->size);
+  if( NULL == slab )
+    return KERN_NO_MEM;
+
+  if( cache->ctor )
+    for(i = 0; i < cache->per_slab; i++)
+      cache->ctor(slab + i * cache->size);
+
+  eflags = disable_preemption();
+  for(i = 0; i < cache->per_slab; i++) {
+    *(void **)(slab + i * cache->size) = cache->free_list;
+    cache->free_list = slab + i * cache->size;
+  }
+  cache->nr_free += cache->per_slab;
+  cache->grows++;
+  enable_preemption(eflags);
+
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_cache_alloc
+ *  @brief     This function takes an object from a cache
+ *  @param     cache - cache of the object kind
+ *  @note      may block on malloc when the cache is empty
+ *  @return    the object; NULL if out of memory
+ */
+
+void *vmm_cache_alloc(vmm_cache *cache) {
+  void   **obj;
+  uint32_t eflags;
+
+  for( ; ; ) {
+    eflags = disable_preemption();
+    obj = cache->free_list;
+    if( obj ) {
+      cache->free_list = *obj;
+      cache->nr_free--;
+      cache->nr_active++;
+      cache->hits++;
+    }
+    enable_preemption(eflags);
+
+    if( obj ) {
+      *obj = NULL;
+      return obj;
+    }
+
+    //-- someone else may empty the new slab before we get back --//
+    if( KERN_SUCCESS != cache_grow(cache) )
+      return NULL;
+  }
+}
+
+
+/** @function  vmm_cache_free
+ *  @brief     This function gives an object back to its cache
+ *  @param     cache - cache it came from
+ *  @param     obj   - object in its constructed state
+ *  @note      may block on malloc when the cache is full
+ *  @return    void
+ */
+
+void vmm_cache_free(vmm_cache *cache,void *obj) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  cache->nr_active--;
+  if( cache->nr_free < cache->max_free ) {
+    *(void **)obj = cache->free_list;
+    cache->free_list = obj;
+    cache->nr_free++;
+    obj = NULL;
+  }
+  else
+    cache->releases++;
+  enable_preemption(eflags);
+
+  if( obj )
+    sfree(obj,cache->size);
+}
+
+
+/** @function  vmm_cache_totals
+ *  @brief     This function adds up the statistics of every cache
+ *  @param     stats - memstats to fill in
+ *  @return    void
+ */
+
+void vmm_cache_totals(memstats_t *stats) {
+  vmm_cache *cache;
+
+  stats->cache_objects_active = 0;
+  stats->cache_objects_free   = 0;
+  stats->cache_hits           = 0;
+  stats->cache_grows          = 0;
+  for(cache = kernel_vmm.caches; cache; cache = cache->next) {
+    stats->cache_objects_active += cache->nr_active;
+    stats->cache_objects_free   += cache->nr_free;
+    stats->cache_hits           += cache->hits;
+    stats->cache_grows          += cache->grows;
+  }
+}
+
+
+/** @function  vmm_cache_dump
+ *  @brief     This function prints the statistics of every cache; meant
+ *             to be called from the debugger
+ *  @return    void
+ */
+
+void vmm_cache_dump(void) {
+  vmm_cache *cache;
+
+  for(cache = kernel_vmm.caches; cache; cache = cache->next)
+    lprintf("cache %s: size %d active %d free %d hits %d slabs %d released %d",
+	    cache->name,
+	    cache->size,
+	    cache->nr_active,
+	    cache->nr_free,
+	    cache->hits,
+	    cache->grows,
+	    cache->releases);
+}
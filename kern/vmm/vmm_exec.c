@@ -0,0 +1,285 @@
+/** @file     vmm_exec.c
+ *  @brief    This file contains the routines that rebuild the user half
+ *            of an address space in place for exec
+ *
+ *            An exec runs in two steps. The stage step gathers everything
+ *            the new user space needs: its range structures, one page
+ *            table for every page directory entry the ranges touch, the
+ *            frames of the pages that have to be there before the program
+ *            runs, and the reverse mapping entries for both. The old user
+ *            space is untouched while this happens, so running out of
+ *            memory can still be reported to the program. The commit step
+ *            tears the old user space down and builds the new one out of
+ *            the staged pieces. It cannot fail.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+#include "i386lib/i386systemregs.h"
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  stage_pde_span
+ *  @brief     This function finds the page directory entries of a range
+ *  @param     range - page aligned range
+ *  @param     first - placeholder for the first PDE index
+ *  @param     last  - placeholder for the last PDE index
+ *  @return    void
+ */
+
+static void stage_pde_span(vm_range *range,int *first,int *last) {
+  LINEAR_ADDRESS_BREAKER la;
+
+  la.address = range->start;
+  *first = la.u.PDE_IDX;
+  //-- last byte rather than end; a range ending on a 4MB --//
+  //-- boundary does not reach into the next table         --//
+  la.address = range->start + range->len - 1;
+  *last  = la.u.PDE_IDX;
+}
+
+
+/** @function  stage_pde_staged
+ *  @brief     This function checks if an earlier staged range already
+ *             accounted for the page table of a PDE
+ *  @param     stage - exec being staged
+ *  @param     nr    - number of staged ranges to look at
+ *  @param     idx   - PDE index
+ *  @return    1 if it did; 0 otherwise
+ */
+
+static int stage_pde_staged(vmm_exec_stage *stage,int nr,int idx) {
+  int first,last;
+  int i;
+
+  for(i = 0; i < nr; i++) {
+    stage_pde_span(stage->ranges[i],&first,&last);
+    if( idx >= first && idx <= last )
+      return 1;
+  }
+  return 0;
+}
+
+
+/** @function  vmm_exec_stage_init
+ *  @brief     This function starts staging an exec
+ *  @param     stage - exec to stage
+ *  @return    void
+ */
+
+void vmm_exec_stage_init(vmm_exec_stage *stage) {
+  memset(stage,0,sizeof(*stage));
+}
+
+
+/** @function  vmm_exec_stage_range
+ *  @brief     This function stages one user range of the new program
+ *             along with the page tables it needs
+ *  @param     stage - exec being staged
+ *  @param     range - range to add; rounded out to pages on return
+ *  @return    KERN_SUCCESS on success; KERN_ERROR_VM_CANNOT_MAP for a
+ *             range outside user memory; KERN_NO_MEM when out of memory
+ */
+
+KERN_RET_CODE vmm_exec_stage_range(vmm_exec_stage *stage,vm_range *range) {
+  vm_range     *new_range;
+  unsigned long range_end;
+  PTE          *pte_page;
+  int           first,last;
+  int           i;
+
+  //-- scale out to page boundaries as vmm_install_range does --//
+  range_end    = range->start + range->len;
+  range->start = range->start & (unsigned long)(~PAGE_MASK);
+  range_end    = ( range_end + PAGE_SIZE - 1 ) & (unsigned long)(~PAGE_MASK);
+  range->len   = range_end - range->start;
+
+  if( range->start < USER_MEM_START || 0 == range->len )
+    return KERN_ERROR_VM_CANNOT_MAP;
+
+  if( stage->nr_ranges == VMM_EXEC_STAGE_RANGES )
+    return KERN_ERROR_GENERIC;
+
+  new_range = vmm_cache_alloc(&kernel_vmm.range_cache);
+  if( !new_range )
+    return KERN_NO_MEM;
+
+  memset(new_range,0,sizeof(*new_range));
+  new_range->start        = range->start;
+  new_range->len          = range->len;
+  new_range->fault_around = VMM_FAULT_AROUND_PAGES;
+  new_range->flags        = range->flags;
+  new_range->file_bytes   = range->file_bytes;
+  new_range->file_start   = range->file_start;
+  new_range->file_len     = range->file_len;
+  new_range->image        = range->image;
+  new_range->grow_floor   = range->grow_floor;
+  new_range->grow_window  = range->grow_window;
+  Q_INIT_ELEM( new_range , vm_range_next );
+  stage->ranges[stage->nr_ranges++] = new_range;
+
+  //-- one page table for each PDE no earlier range covers --//
+  stage_pde_span(new_range,&first,&last);
+  for(i = first; i <= last; i++) {
+    if( stage_pde_staged(stage,stage->nr_ranges - 1,i) )
+      continue;
+
+    pte_page = vmm_alloc_pte_page();
+    if( !pte_page )
+      return KERN_NO_MEM;
+    *(PTE **)pte_page  = stage->pte_reserve;
+    stage->pte_reserve = pte_page;
+
+    if( KERN_SUCCESS != vmm_rmap_reserve(&stage->rmap_reserve,1) )
+      return KERN_NO_MEM;
+  }
+
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_exec_stage_back
+ *  @brief     This function sets aside zeroed frames for pages that have
+ *             to be present when the new program starts, e.g. the stack
+ *             exec writes argv onto
+ *  @param     stage - exec being staged
+ *  @param     start - page aligned user address inside a staged range
+ *  @param     len   - length in bytes; a multiple of PAGE_SIZE
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when out of memory
+ */
+
+KERN_RET_CODE vmm_exec_stage_back(vmm_exec_stage *stage,
+				  unsigned long start,
+				  unsigned long len) {
+  KERN_RET_CODE ret;
+  unsigned long i;
+
+  for(i = 0; i < len / PAGE_SIZE; i++) {
+    if( stage->nr_pages == VMM_EXEC_STAGE_PAGES )
+      return KERN_NO_MEM;
+
+    ret = vmm_rmap_reserve(&stage->rmap_reserve,1);
+    if( KERN_SUCCESS != ret )
+      return ret;
+
+    ret = vmm_get_zeroed_user_page(&stage->page_pfn[stage->nr_pages]);
+    if( KERN_SUCCESS != ret )
+      return ret;
+    stage->page_addr[stage->nr_pages++] = start + i * PAGE_SIZE;
+  }
+
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_exec_stage_abort
+ *  @brief     This function gives back everything staged for an exec
+ *             that is not going to happen
+ *  @param     stage - exec being staged; empty on return
+ *  @return    void
+ */
+
+void vmm_exec_stage_abort(vmm_exec_stage *stage) {
+  PTE *pte_page;
+  int  i;
+
+  for(i = 0; i < stage->nr_ranges; i++)
+    vmm_cache_free(&kernel_vmm.range_cache,stage->ranges[i]);
+
+  while( stage->pte_reserve ) {
+    pte_page = stage->pte_reserve;
+    stage->pte_reserve = *(PTE **)pte_page;
+    vmm_putref_pte_page(pte_page);
+  }
+
+  for(i = 0; i < stage->nr_pages; i++)
+    vmm_putref_user_page(stage->page_pfn[i]);
+
+  vmm_rmap_release(&stage->rmap_reserve);
+  vmm_exec_stage_init(stage);
+}
+
+
+/** @function  vmm_exec_commit
+ *  @brief     This function replaces the user half of an address space
+ *             with the staged one. Cannot fail
+ *  @param     vm    - pointer to the exec'ing task's VM
+ *  @param     stage - staged exec; empty on return
+ *  @return    void
+ */
+
+void vmm_exec_commit(struct task_vm *vm,vmm_exec_stage *stage) {
+  vm_range *range;
+  PTE      *pte_page;
+  PTE      *pte;
+  PDE      *pde;
+  int       first,last;
+  int       i,j;
+
+  //-- tear down the old user space --//
+  vmm_unback_all_user_ranges(vm);
+  vmm_free_user_ptes(vm);
+  vmm_free_all_vma(vm);
+
+  //-- link the new ranges and hang the staged page tables --//
+  for(i = 0; i < stage->nr_ranges; i++) {
+    range = stage->ranges[i];
+    Q_INSERT_FRONT( &vm->vm_ranges_head , range , vm_range_next );
+    vmm_range_tree_insert( vm , range );
+
+    stage_pde_span(range,&first,&last);
+    for(j = first; j <= last; j++) {
+      pde = &vm->pde_base[j];
+      if( pde->PRESENT )
+	continue;
+
+      assert( stage->pte_reserve );
+      pte_page = stage->pte_reserve;
+      stage->pte_reserve = *(PTE **)pte_page;
+      *(PTE **)pte_page = NULL;
+
+      //-- same as vmm_install_pte_page --//
+      pde->PRESENT = 1;
+      pde->RW      = 1;
+      pde->US      = 1;
+      pde->GLOBAL  = 0;
+      pde->ADDRESS = (unsigned long)pte_page >> PAGING_PAGE_OFFSET_BITS;
+      vmm_rmap_link(&stage->rmap_reserve,
+		    PTE_PAGE_PFN(pte_page),
+		    vm,
+		    j * LARGE_PAGE_SIZE,
+		    NULL);
+    }
+  }
+  assert( NULL == stage->pte_reserve );
+
+  //-- map the pages that have to be there up front --//
+  for(i = 0; i < stage->nr_pages; i++) {
+    pte = vmm_get_pte(vm,stage->page_addr[i]);
+    assert(pte);
+    vmm_rmap_link(&stage->rmap_reserve,stage->page_pfn[i],NULL,0,pte);
+    pte->ADDRESS  = stage->page_pfn[i];
+    pte->RW       = 1;
+    pte->US       = 1;
+    pte->ACCESSED = 1;     //- exec writes argv here; keep it off swap -//
+    pte->PRESENT  = 1;
+  }
+  assert( NULL == stage->rmap_reserve );
+
+  //-- the old user mappings are gone --//
+  vmm_tlb_flush_all(vm);
+
+  stage->nr_ranges = 0;
+  stage->nr_pages  = 0;
+}
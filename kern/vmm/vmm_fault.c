@@ -0,0 +1,688 @@
+/** @file     vmm_fault.c
+ *  @brief    This file contains the demand paging routines for user ranges
+ *
+ *            Pages of a user range are backed lazily. A read of a page
+ *            that was never touched maps the global zero frame read only;
+ *            the first write replaces it with a private zeroed frame the
+ *            same way a copy on write page is broken. Ranges that are only
+ *            ever read (bss tails, sparse heaps) cost no frames at all.
+ *
+ *            A fault also resolves the neighbouring pages of its range
+ *            that would take the same fault, within an aligned window of
+ *            vm_range.fault_around pages, so a streaming writer takes one
+ *            fault per window instead of one per page. The window never
+ *            leaves the range, which was charged against the task's quota
+ *            when it was created.
+ *
+ *            Ranges loaded from an executable name the image bytes that
+ *            back them. Their pages are filled on first touch straight
+ *            from the exec2obj image, so an exec only pays for the pages
+ *            the program actually uses. Sections can share a page; the
+ *            fill copies the bytes of every range that covers it.
+ *            Read only pages of a program are the same in every
+ *            instance; they are filled once and then shared through
+ *            the program image cache (see vmm_image.c).
+ *
+ *            Pages written out under memory pressure (see vmm_swap.c)
+ *            are read back into a private frame on the next touch.
+ *            Freshly mapped pages start out accessed so the swap clock
+ *            does not pick them before the access that faulted them in.
+ *
+ *            Pages of a shared memory segment (see vmm_shm.c) always map
+ *            the segment's frame. They are never copied on write; a
+ *            write to one left write protected by a page table copied
+ *            after fork just makes it writable again.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+#include "i386lib/i386systemregs.h"
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  file_copy_range
+ *  @brief     This function works out which bytes of a page come from
+ *             the image backing a range
+ *  @param     range  - user range
+ *  @param     page   - page aligned user address
+ *  @param     offset - placeholder for the offset in the page
+ *  @param     src    - placeholder for the first image byte
+ *  @return    number of bytes to copy; 0 if the image misses the page
+ */
+
+static int file_copy_range(vm_range *range,
+			   unsigned long page,
+			   int *offset,
+			   const char **src) {
+  unsigned long first;
+  unsigned long last;
+
+  if( NULL == range->file_bytes || 0 == range->file_len )
+    return 0;
+
+  //-- last bytes rather than ends; no wrap at 4GB --//
+  first = range->file_start;
+  last  = range->file_start + range->file_len - 1;
+  if( first > page + PAGE_SIZE - 1 || last < page )
+    return 0;
+
+  if( first < page )
+    first = page;
+  if( last > page + PAGE_SIZE - 1 )
+    last = page + PAGE_SIZE - 1;
+
+  *offset = first - page;
+  *src    = range->file_bytes + ( first - range->file_start );
+  return last - first + 1;
+}
+
+
+/** @function  page_ranges
+ *  @brief     This function finds the ranges covering a page; only the
+ *             sections of one executable ever share a page
+ *  @param     vm     - pointer to the task's VM
+ *  @param     page   - page aligned user address
+ *  @param     ranges - placeholder for VMM_EXEC_STAGE_RANGES ranges
+ *  @return    number of ranges found
+ */
+
+static int page_ranges(struct task_vm *vm,unsigned long page,vm_range **ranges) {
+  //-- ranges are whole pages; the last byte is left out so the end --//
+  //-- of the top page does not wrap to 0                           --//
+  return vmm_range_tree_overlap_all(vm,page,page + PAGE_MASK,
+				    ranges,VMM_EXEC_STAGE_RANGES);
+}
+
+
+/** @function  file_page_backed
+ *  @brief     This function checks if any image bytes land in a page
+ *  @param     vm   - pointer to the task's VM
+ *  @param     page - page aligned user address
+ *  @return    1 if the page has to be filled from an image; 0 otherwise
+ */
+
+static int file_page_backed(struct task_vm *vm,unsigned long page) {
+  vm_range   *ranges[VMM_EXEC_STAGE_RANGES];
+  const char *src;
+  int         offset;
+  int         nr;
+  int         i;
+
+  nr = page_ranges(vm,page,ranges);
+  for(i = 0; i < nr; i++) {
+    if( file_copy_range(ranges[i],page,&offset,&src) )
+      return 1;
+  }
+  return 0;
+}
+
+
+/** @function  file_fill_page
+ *  @brief     This function copies the image bytes of every range
+ *             covering a page into a zeroed frame
+ *  @param     vm   - pointer to the task's VM
+ *  @param     page - page aligned user address
+ *  @param     pfn  - zeroed frame that will back the page
+ *  @return    void
+ */
+
+static void file_fill_page(struct task_vm *vm,unsigned long page,PFN pfn) {
+  vm_range   *ranges[VMM_EXEC_STAGE_RANGES];
+  const char *src;
+  int         offset;
+  int         len;
+  int         nr;
+  int         i;
+
+  nr = page_ranges(vm,page,ranges);
+  for(i = 0; i < nr; i++) {
+    len = file_copy_range(ranges[i],page,&offset,&src);
+    if( len )
+      vmm_fill_user_page(pfn,offset,src,len);
+  }
+  kernel_vmm.file_page_fills++;
+}
+
+
+/** @function  file_page_image
+ *  @brief     This function finds the image cache slot of a page
+ *  @param     vm   - pointer to the task's VM
+ *  @param     page - page aligned user address
+ *  @return    the cache slot of a range covering the page; NULL if none
+ */
+
+static vmm_image *file_page_image(struct task_vm *vm,unsigned long page) {
+  vm_range *ranges[VMM_EXEC_STAGE_RANGES];
+  int       nr;
+  int       i;
+
+  nr = page_ranges(vm,page,ranges);
+  for(i = 0; i < nr; i++) {
+    if( ranges[i]->image )
+      return ranges[i]->image;
+  }
+  return NULL;
+}
+
+
+/** @function  swap_in_page
+ *  @brief     This function reads a swapped out page back into a frame
+ *             of its own
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address being accessed
+ *  @param     pte     - swapped out PTE in a table of this VM alone
+ *  @param     ro      - 1 if the range is read only
+ *  @return    KERN_SUCCESS when the access can be retried;
+ *             KERN_NO_MEM when out of frames
+ */
+
+static KERN_RET_CODE swap_in_page(struct task_vm *vm,
+				  uint32_t address,
+				  PTE *pte,
+				  int ro) {
+  KERN_RET_CODE ret;
+  unsigned long handle = pte->ADDRESS;
+  vmm_rmap     *pool   = NULL;
+  uint32_t      eflags;
+  PFN           new_pfn;
+
+  ret = vmm_rmap_reserve(&pool,1);
+  if( KERN_SUCCESS == ret )
+    ret = vmm_get_free_user_pages(&new_pfn);
+  if( KERN_SUCCESS != ret ) {
+    vmm_rmap_release(&pool);
+    return ret;
+  }
+
+  //-- another thread may have brought it back while we blocked --//
+  eflags = disable_preemption();
+  if( !PTE_IS_SWAPPED(pte) || handle != pte->ADDRESS ) {
+    enable_preemption(eflags);
+    vmm_putref_user_page(new_pfn);
+    vmm_rmap_release(&pool);
+    return KERN_SUCCESS;
+  }
+
+  vmm_swap_read(handle,new_pfn);
+  vmm_swap_put(handle);
+  vmm_rmap_link(&pool,new_pfn,NULL,0,pte);
+  pte->ADDRESS  = new_pfn;
+  pte->AVAIL    = 0;
+  pte->RW       = !ro;
+  pte->US       = 1;
+  pte->ACCESSED = 1;
+  pte->PRESENT  = 1;
+  kernel_vmm.swap_ins++;
+  enable_preemption(eflags);
+
+  vmm_tlb_flush_page(vm,address);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  shm_map_page
+ *  @brief     This function maps the segment frame behind a page of a
+ *             shared memory range, writable
+ *  @param     vm      - pointer to the task's VM
+ *  @param     range   - VM_RANGE_SHARED range holding the address
+ *  @param     address - user address being accessed
+ *  @param     pte     - PTE of the page in a table of this VM alone
+ *  @return    KERN_SUCCESS when the access can be retried;
+ *             KERN_NO_MEM when out of memory
+ */
+
+static KERN_RET_CODE shm_map_page(struct task_vm *vm,
+				  vm_range *range,
+				  uint32_t address,
+				  PTE *pte) {
+  KERN_RET_CODE ret;
+  vmm_rmap     *pool = NULL;
+  uint32_t      eflags;
+  PFN           pfn;
+
+  pfn = range->shm->frames[( (address & ~PAGE_MASK) - range->start ) / PAGE_SIZE];
+
+  //-- write protected by the page table copy after fork; not COW --//
+  if( pte->PRESENT ) {
+    assert( pfn == pte->ADDRESS );
+    pte->RW = 1;
+    vmm_tlb_flush_page(vm,address);
+    return KERN_SUCCESS;
+  }
+
+  ret = vmm_rmap_reserve(&pool,1);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  //-- another thread may have mapped it while we blocked --//
+  eflags = disable_preemption();
+  if( !pte->PRESENT ) {
+    vmm_getref_user_page(pfn);
+    vmm_rmap_link(&pool,pfn,NULL,0,pte);
+    pte->ADDRESS  = pfn;
+    pte->RW       = 1;
+    pte->US       = 1;
+    pte->ACCESSED = 1;
+    pte->PRESENT  = 1;
+    kernel_vmm.shm_maps++;
+  }
+  enable_preemption(eflags);
+
+  vmm_rmap_release(&pool);
+  vmm_tlb_flush_page(vm,address);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  fault_in_page
+ *  @brief     This function resolves one not present or write protected
+ *             user page - image bytes if the page has any, else zero page
+ *             on read, fresh or copied frame on write
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address being accessed; inside a range
+ *  @param     write   - 1 if the access is a write
+ *  @return    KERN_SUCCESS when the access can be retried;
+ *             KERN_PAGE_ERR on a write to a read only range;
+ *             KERN_NO_MEM when out of frames
+ */
+
+static KERN_RET_CODE fault_in_page(struct task_vm *vm,uint32_t address,int write) {
+  KERN_RET_CODE ret;
+  PDE *pde;
+  PTE *pte;
+  PFN  new_pfn;
+  PFN  old_pfn;
+  int  ro;
+  uint32_t eflags;
+  vmm_image *image;
+  vm_range  *range;
+  vmm_rmap  *pool = NULL;
+
+  ro = vmm_is_address_ro(vm,(void *)address);
+  if( write && ro )
+    return KERN_PAGE_ERR;
+
+  //-- 4MB pages are only ever write protected for copy on write --//
+  pde = vmm_get_pde(vm,address);
+  if( PDE_IS_LARGE(pde) ) {
+    if( !write || pde->RW )
+      return KERN_SUCCESS;
+
+    ret = vmm_unshare_large_page(vm,address);
+    if( KERN_SUCCESS != ret || PDE_IS_LARGE(pde) )
+      return ret;
+    //-- split into 4K pages; break the one being written below --//
+  }
+
+  ret = vmm_install_pte_page(vm,address);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  //-- every action below edits the PTE; never in a shared table --//
+  pde = vmm_get_pde(vm,address);
+  if( !pde->RW ) {
+    ret = vmm_unshare_pte_page(vm,address);
+    if( KERN_SUCCESS != ret )
+      return ret;
+  }
+  pte = vmm_get_pte(vm,address);
+
+  //-- already good for this access --//
+  if( pte->PRESENT && ( !write || pte->RW ) )
+    return KERN_SUCCESS;
+
+  if( PTE_IS_SWAPPED(pte) )
+    return swap_in_page(vm,address,pte,ro);
+
+  //-- segment frames are mapped as they are, never copied --//
+  range = vmm_range_tree_lookup(vm,address);
+  if( range && range->shm )
+    return shm_map_page(vm,range,address,pte);
+
+  //-- first touch of a page loaded from an executable          --//
+  //-- read only pages come from, or go to, the image cache      --//
+  if( !pte->PRESENT && file_page_backed(vm,address & ~PAGE_MASK) ) {
+    image   = ro ? file_page_image(vm,address & ~PAGE_MASK) : NULL;
+    new_pfn = image ? vmm_image_lookup(image,address & ~PAGE_MASK) : PFN_NULL;
+    if( PFN_NULL == new_pfn ) {
+      ret = vmm_get_zeroed_user_page(&new_pfn);
+      if( KERN_SUCCESS != ret )
+	return ret;
+
+      file_fill_page(vm,address & ~PAGE_MASK,new_pfn);
+      if( image )
+	vmm_image_insert(image,address & ~PAGE_MASK,new_pfn);
+    }
+    ret = vmm_rmap_reserve(&pool,1);
+    if( KERN_SUCCESS != ret ) {
+      vmm_rmap_release(&pool);
+      vmm_putref_user_page(new_pfn);
+      return ret;
+    }
+
+    //-- another thread may have mapped it while we blocked; the --//
+    //-- cache keeps its own reference if the frame went there   --//
+    eflags = disable_preemption();
+    if( pte->PRESENT || PTE_IS_SWAPPED(pte) ) {
+      enable_preemption(eflags);
+      vmm_putref_user_page(new_pfn);
+      vmm_rmap_release(&pool);
+      return KERN_SUCCESS;
+    }
+
+    vmm_rmap_link(&pool,new_pfn,NULL,0,pte);
+    pte->ADDRESS  = new_pfn;
+    pte->RW       = !ro;
+    pte->US       = 1;
+    pte->ACCESSED = 1;
+    pte->PRESENT  = 1;
+    enable_preemption(eflags);
+    vmm_tlb_flush_page(vm,address);
+    return KERN_SUCCESS;
+  }
+
+  //-- first read of an untouched page --//
+  if( !pte->PRESENT && !write ) {
+    vmm_getref_user_page(kernel_vmm.zero_pfn);
+    kernel_vmm.zero_page_maps++;
+    pte->ADDRESS = kernel_vmm.zero_pfn;
+    pte->RW      = 0;
+    pte->US      = 1;
+    pte->PRESENT = 1;
+    vmm_tlb_flush_page(vm,address);
+    return KERN_SUCCESS;
+  }
+
+  //-- the frame cannot be swapped out while it is being looked at --//
+  eflags  = disable_preemption();
+  old_pfn = pte->PRESENT ? pte->ADDRESS : PFN_NULL;
+  if( PTE_IS_SWAPPED(pte) ) {
+    //-- evicted since the checks above; start over --//
+    enable_preemption(eflags);
+    return fault_in_page(vm,address,write);
+  }
+
+  //-- everyone else let go of the page; keep it instead of copying --//
+  if( PFN_NULL != old_pfn && kernel_vmm.zero_pfn != old_pfn &&
+      1 == kernel_vmm.m_pages[old_pfn].refcount ) {
+    kernel_vmm.cow_promotions++;
+    pte->RW = !ro;
+    enable_preemption(eflags);
+    vmm_tlb_flush_page(vm,address);
+    return KERN_SUCCESS;
+  }
+
+  //-- pin the frame being copied; swap passes over extra references --//
+  if( PFN_NULL != old_pfn && kernel_vmm.zero_pfn != old_pfn )
+    vmm_getref_user_page(old_pfn);
+  enable_preemption(eflags);
+
+  if( PFN_NULL == old_pfn || kernel_vmm.zero_pfn == old_pfn )
+    ret = vmm_get_zeroed_user_page(&new_pfn);
+  else {
+    ret = vmm_get_free_user_pages(&new_pfn);
+    if( KERN_SUCCESS == ret ) {
+      vmm_copy_user_page(new_pfn,old_pfn);
+      kernel_vmm.cow_copies++;
+    }
+    vmm_putref_user_page(old_pfn);
+  }
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  ret = vmm_rmap_reserve(&pool,1);
+  if( KERN_SUCCESS != ret ) {
+    vmm_rmap_release(&pool);
+    vmm_putref_user_page(new_pfn);
+    return ret;
+  }
+
+  //-- another thread may have broken or mapped it while we blocked --//
+  eflags = disable_preemption();
+  if( PFN_NULL == old_pfn ?
+      ( pte->PRESENT || PTE_IS_SWAPPED(pte) ) :
+      ( !pte->PRESENT || old_pfn != pte->ADDRESS || pte->RW ) ) {
+    enable_preemption(eflags);
+    vmm_putref_user_page(new_pfn);
+    vmm_rmap_release(&pool);
+    return KERN_SUCCESS;
+  }
+
+  vmm_rmap_link(&pool,new_pfn,NULL,0,pte);
+  pte->ADDRESS  = new_pfn;
+  pte->RW       = !ro;
+  pte->US       = 1;
+  pte->ACCESSED = 1;
+  pte->PRESENT  = 1;
+  enable_preemption(eflags);
+  vmm_tlb_flush_page(vm,address);
+
+  //-- drop our reference to the shared page --//
+  if( PFN_NULL != old_pfn ) {
+    vmm_rmap_remove(old_pfn,NULL,0,pte);
+    if( kernel_vmm.zero_pfn == old_pfn )
+      kernel_vmm.zero_page_breaks++;
+    vmm_putref_user_page(old_pfn);
+  }
+  return KERN_SUCCESS;
+}
+
+
+/** @function  fault_around
+ *  @brief     This function resolves the pages next to a faulting one
+ *             that would fault the same way, inside the range's aligned
+ *             fault-around window. Best effort; stops when memory is low
+ *  @param     vm      - pointer to the task's VM
+ *  @param     range   - range holding the faulting address
+ *  @param     address - faulting address; already resolved
+ *  @param     write   - 1 if the access was a write
+ *  @return    number of neighbouring pages resolved
+ */
+
+static int fault_around(struct task_vm *vm,
+			vm_range *range,
+			uint32_t address,
+			int write) {
+  unsigned long window;
+  unsigned long first;
+  unsigned long last;
+  unsigned long neighbour;
+  PTE *pte;
+  int  nr_pages;
+  int  i;
+  int  mapped = 0;
+
+  //-- a 4MB page that is still whole has no neighbours to resolve --//
+  if( range->fault_around <= 1 || PDE_IS_LARGE(vmm_get_pde(vm,address)) )
+    return 0;
+
+  //-- aligned window so it never crosses a page table         --//
+  //-- last pages rather than ends; a range may end at 4GB     --//
+  window = range->fault_around * PAGE_SIZE;
+  first  = address & ~(window - 1);
+  last   = first + window - PAGE_SIZE;
+  if( first < range->start )
+    first = range->start;
+  if( last > range->start + range->len - PAGE_SIZE )
+    last = range->start + range->len - PAGE_SIZE;
+  nr_pages = ( last - first ) / PAGE_SIZE + 1;
+
+  for(i = 0; i < nr_pages; i++) {
+    neighbour = first + i * PAGE_SIZE;
+    if( neighbour == (address & ~PAGE_MASK) )
+      continue;
+
+    //-- only pages that would take the same fault --//
+    pte = vmm_get_pte(vm,neighbour);
+    if( !write && pte->PRESENT )
+      continue;
+    if( write && pte->PRESENT &&
+	( pte->RW || vmm_is_address_ro(vm,(void *)neighbour) ) )
+      continue;
+
+    //-- frames are spent only while there are plenty --//
+    if( ( write || PTE_IS_SWAPPED(pte) || file_page_backed(vm,neighbour) ) &&
+	vmm_nr_free_user_pages() <= VMM_FAULT_AROUND_LOW )
+      break;
+
+    if( KERN_SUCCESS != fault_in_page(vm,neighbour,write) )
+      break;
+    mapped++;
+  }
+
+  if( mapped ) {
+    kernel_vmm.fault_around_faults++;
+    kernel_vmm.fault_around_pages += mapped;
+  }
+  return mapped;
+}
+
+
+/** @function  vmm_fault_in
+ *  @brief     This function resolves a not present or write protected
+ *             user page - zero page on read, fresh or copied frame on write.
+ *             Neighbouring pages in the range's fault-around window are
+ *             resolved along with it
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address being accessed
+ *  @param     write   - 1 if the access is a write
+ *  @return    KERN_SUCCESS when the access can be retried;
+ *             KERN_ERROR_ADDRESS_NOT_PRESENT outside of any range;
+ *             KERN_PAGE_ERR on a write to a read only range;
+ *             KERN_NO_MEM when out of frames
+ */
+
+KERN_RET_CODE vmm_fault_in(struct task_vm *vm,uint32_t address,int write) {
+  KERN_RET_CODE ret;
+  vm_range *range;
+
+  if( address < USER_MEM_START )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+  range = vmm_range_tree_lookup(vm,address);
+  if( NULL == range )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+  ret = fault_in_page(vm,address,write);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  fault_around(vm,range,address,write);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_set_fault_around
+ *  @brief     This function sets how many pages a demand fault in
+ *             the range resolves at once
+ *  @param     range - user range to tune
+ *  @param     pages - window size; a power of 2 up to PTE_PER_PAGE, 1 for off
+ *  @return    KERN_SUCCESS on success; KERN_ERROR_GENERIC on a bad size
+ */
+
+KERN_RET_CODE vmm_set_fault_around(vm_range *range,int pages) {
+  if( pages < 1 || pages > PTE_PER_PAGE || ( pages & (pages - 1) ) )
+    return KERN_ERROR_GENERIC;
+
+  range->fault_around = pages;
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_prefault_range
+ *  @brief     This function backs the pages of part of a range ahead of
+ *             use, the way the first touch of each would: writable pages
+ *             get a frame of their own. Best effort; stops when memory
+ *             is low
+ *  @param     vm    - pointer to the task's VM
+ *  @param     start - page aligned user address inside a range
+ *  @param     len   - length in bytes; a multiple of PAGE_SIZE
+ *  @return    number of pages resolved
+ */
+
+int vmm_prefault_range(struct task_vm *vm,
+		       unsigned long start,
+		       unsigned long len) {
+  unsigned long address;
+  unsigned long last;
+  int mapped = 0;
+
+  //-- last page rather than end; stops inside the span even --//
+  //-- if the caller's end would wrap to 0                    --//
+  last = start + len - PAGE_SIZE;
+  for(address = start; ; address += PAGE_SIZE) {
+    if( vmm_nr_free_user_pages() <= VMM_FAULT_AROUND_LOW )
+      break;
+
+    if( KERN_SUCCESS != fault_in_page(vm,address,
+				      !vmm_is_address_ro(vm,(void *)address)) )
+      break;
+    mapped++;
+
+    if( address == last )
+      break;
+  }
+
+  kernel_vmm.prefaulted_pages += mapped;
+  return mapped;
+}
+
+
+/** @function  vmm_fault_in_range
+ *  @brief     This function faults in every page of a user buffer so the
+ *             kernel can access it without taking a page fault itself.
+ *             Only the buffer's own pages are resolved; no fault-around
+ *  @param     vm        - pointer to the task's VM
+ *  @param     base_addr - start of the user buffer
+ *  @param     len       - length of the buffer in bytes
+ *  @param     write     - 1 if the kernel is going to write the buffer
+ *  @return    KERN_SUCCESS on success; vmm_fault_in error otherwise
+ */
+
+KERN_RET_CODE vmm_fault_in_range(struct task_vm *vm,
+				 void *base_addr,
+				 int len,
+				 int write) {
+  KERN_RET_CODE ret;
+  unsigned long address;
+  unsigned long last;
+  PTE          *pte;
+
+  if( len <= 0 )
+    return KERN_SUCCESS;
+
+  //-- last byte rather than end; a user buffer may end at 4GB --//
+  last    = ( (unsigned long)base_addr + len - 1 ) & ~PAGE_MASK;
+  address = (unsigned long)base_addr & ~PAGE_MASK;
+  for( ; ; address += PAGE_SIZE) {
+    if( address < USER_MEM_START ||
+	NULL == vmm_range_tree_lookup(vm,address) )
+      return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+    ret = fault_in_page(vm,address,write);
+    if( KERN_SUCCESS != ret )
+      return ret;
+
+    //-- the kernel is about to use it; keep swap and merging off it --//
+    if( !PDE_IS_LARGE(vmm_get_pde(vm,address)) ) {
+      pte = vmm_get_pte(vm,address);
+      pte->ACCESSED = 1;
+      PTE_SET_AGE(pte,0);
+    }
+
+    if( address == last )
+      break;
+  }
+
+  return KERN_SUCCESS;
+}
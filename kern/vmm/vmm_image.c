@@ -0,0 +1,226 @@
+/** @file     vmm_image.c
+ *  @brief    This file contains the cache of read only program frames
+ *
+ *            Every exec of a program lays out its text and rodata the
+ *            same way, so a read only page holds the same bytes in every
+ *            instance. The first instance to touch such a page fills a
+ *            frame from the exec2obj image and hands it to the cache;
+ *            later instances map the cached frame read only instead of
+ *            filling a copy of their own.
+ *
+ *            There is one cache slot per executable, keyed by its bytes
+ *            in the exec2obj table. A slot covers the pages from the
+ *            first to the last read only page of the program. The cache
+ *            holds one reference on each frame it keeps. When frames run
+ *            out, the frames that nobody else maps are given back.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+#include <exec2obj.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+//-- one slot per executable in the exec2obj table --//
+static vmm_image image_cache[MAX_NUM_APP_ENTRIES];
+
+
+/** @function  image_frame_slot
+ *  @brief     This function finds the frame slot of a user page
+ *  @param     image - program image
+ *  @param     page  - page aligned user address
+ *  @return    pointer to the frame slot; NULL outside the cached pages
+ */
+
+static PFN *image_frame_slot(vmm_image *image,unsigned long page) {
+  if( NULL == image->frames || page < image->start )
+    return NULL;
+
+  if( ( page - image->start ) / PAGE_SIZE >= (unsigned long)image->nr_pages )
+    return NULL;
+
+  return &image->frames[( page - image->start ) / PAGE_SIZE];
+}
+
+
+/** @function  image_find
+ *  @brief     This function finds the cache slot of a program
+ *  @param     execbytes - the program's bytes in the exec2obj table
+ *  @param     unused    - placeholder for a free slot; may be NULL
+ *  @note      called with preemption disabled
+ *  @return    the slot; NULL if the program has none yet
+ */
+
+static vmm_image *image_find(const char *execbytes,vmm_image **unused) {
+  int i;
+
+  for(i = 0; i < MAX_NUM_APP_ENTRIES; i++) {
+    if( execbytes == image_cache[i].execbytes )
+      return &image_cache[i];
+    if( unused && NULL == *unused && NULL == image_cache[i].execbytes )
+      *unused = &image_cache[i];
+  }
+  return NULL;
+}
+
+
+/** @function  vmm_image_get
+ *  @brief     This function finds or sets up the cache slot of a program
+ *  @param     execbytes - the program's bytes in the exec2obj table
+ *  @param     start     - first read only user page of the program
+ *  @param     len       - bytes from start to the end of the last
+ *                         read only page
+ *  @return    the cache slot; NULL if the program cannot be cached
+ */
+
+vmm_image *vmm_image_get(const char *execbytes,
+			 unsigned long start,
+			 unsigned long len) {
+  vmm_image *image;
+  vmm_image *unused = NULL;
+  PFN       *frames;
+  uint32_t   eflags;
+  int        nr_pages;
+  int        i;
+
+  nr_pages = len / PAGE_SIZE;
+  if( 0 == nr_pages )
+    return NULL;
+
+  eflags = disable_preemption();
+  image = image_find(execbytes,NULL);
+  enable_preemption(eflags);
+  if( image ) {
+    //-- every instance of a program has the same layout --//
+    assert( image->start == start && image->nr_pages == nr_pages );
+    return image;
+  }
+
+  //-- malloc may block; allocate before claiming a slot --//
+  frames = malloc(nr_pages * sizeof(PFN));
+  if( NULL == frames )
+    return NULL;
+  for(i = 0; i < nr_pages; i++)
+    frames[i] = PFN_NULL;
+
+  eflags = disable_preemption();
+  image = image_find(execbytes,&unused);
+  if( NULL == image && NULL != unused ) {
+    image = unused;
+    image->execbytes = execbytes;
+    image->start     = start;
+    image->nr_pages  = nr_pages;
+    image->nr_cached = 0;
+    image->frames    = frames;
+    frames = NULL;
+  }
+  enable_preemption(eflags);
+
+  //-- set up by another exec of the same program meanwhile --//
+  if( frames )
+    free(frames);
+
+  return image;
+}
+
+
+/** @function  vmm_image_lookup
+ *  @brief     This function looks up the cached frame of a read only page
+ *  @param     image - program image
+ *  @param     page  - page aligned user address
+ *  @return    the frame with a reference taken for the caller;
+ *             PFN_NULL if the page is not cached
+ */
+
+PFN vmm_image_lookup(vmm_image *image,unsigned long page) {
+  uint32_t eflags;
+  PFN     *slot;
+  PFN      pfn = PFN_NULL;
+
+  eflags = disable_preemption();
+  slot = image_frame_slot(image,page);
+  if( slot && PFN_NULL != *slot ) {
+    pfn = *slot;
+    vmm_getref_user_page(pfn);
+    kernel_vmm.image_hits++;
+  }
+  else
+    kernel_vmm.image_misses++;
+  enable_preemption(eflags);
+
+  return pfn;
+}
+
+
+/** @function  vmm_image_insert
+ *  @brief     This function hands a freshly filled read only frame to the
+ *             cache; the cache takes its own reference
+ *  @param     image - program image
+ *  @param     page  - page aligned user address the frame was filled for
+ *  @param     pfn   - frame holding the page's bytes
+ *  @return    void
+ */
+
+void vmm_image_insert(vmm_image *image,unsigned long page,PFN pfn) {
+  uint32_t eflags;
+  PFN     *slot;
+
+  eflags = disable_preemption();
+  slot = image_frame_slot(image,page);
+  //-- someone else may have filled it meanwhile; keep theirs --//
+  if( slot && PFN_NULL == *slot ) {
+    vmm_getref_user_page(pfn);
+    *slot = pfn;
+    image->nr_cached++;
+    kernel_vmm.image_frames++;
+  }
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_image_reclaim
+ *  @brief     This function gives back the cached frames that no task
+ *             maps any more; frames still in use stay cached since
+ *             dropping them would not free anything
+ *  @return    number of frames released
+ */
+
+int vmm_image_reclaim(void) {
+  vmm_image *image;
+  uint32_t   eflags;
+  int        released = 0;
+  int        i,j;
+
+  eflags = disable_preemption();
+  for(i = 0; i < MAX_NUM_APP_ENTRIES; i++) {
+    image = &image_cache[i];
+    if( NULL == image->frames || 0 == image->nr_cached )
+      continue;
+
+    for(j = 0; j < image->nr_pages; j++) {
+      if( PFN_NULL == image->frames[j] ||
+	  1 != kernel_vmm.m_pages[image->frames[j]].refcount )
+	continue;
+
+      vmm_putref_user_page(image->frames[j]);
+      image->frames[j] = PFN_NULL;
+      image->nr_cached--;
+      kernel_vmm.image_frames--;
+      kernel_vmm.image_evictions++;
+      released++;
+    }
+  }
+  enable_preemption(eflags);
+
+  return released;
+}
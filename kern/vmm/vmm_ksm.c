@@ -0,0 +1,221 @@
+/** @file     vmm_ksm.c
+ *  @brief    This file contains same page merging of user frames
+ *
+ *            The idle thread walks the user frames with a cursor and
+ *            hashes the ones that are settled: every reference is a PTE
+ *            in a page table of its own, and the working set sampler saw
+ *            none of those PTEs touched for VMM_KSM_MIN_AGE passes. A
+ *            frame of zeroes is dropped for the zero frame. Any other
+ *            frame is looked up by hash in a small table of frames seen
+ *            before; when the frame found there holds the same bytes,
+ *            every PTE of the new frame is pointed at it, both are write
+ *            protected and the new frame is freed.
+ *
+ *            Nothing else is needed to split them again. A write to a
+ *            merged page takes the copy on write fault a page shared by
+ *            fork takes, and the last owner standing gets its frame made
+ *            writable again. The table is only a hint; frames found in
+ *            it are checked again and compared byte for byte with
+ *            preemption disabled, so no write can slip in between the
+ *            compare and the write protection.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+static PFN      ksm_cursor = USER_FIRST_PFN;
+
+//-- frames seen before, by hash; entries may be stale --//
+static PFN      ksm_frames[VMM_KSM_BUCKETS];
+static uint32_t ksm_hashes[VMM_KSM_BUCKETS];
+
+
+/** @function  ksm_candidate
+ *  @brief     This function checks that a frame can be merged: it is
+ *             only mapped by PTEs we can rewrite alone, and has not been
+ *             touched for a while
+ *  @param     pfn - user frame
+ *  @note      called with preemption disabled
+ *  @return    1 if it can; 0 otherwise
+ */
+
+static int ksm_candidate(PFN pfn) {
+  m_page   *page = &kernel_vmm.m_pages[pfn];
+  vmm_rmap *slot;
+  PTE      *pte_page;
+  int       nr_slots = 0;
+
+  if( kernel_vmm.zero_pfn == pfn || NULL == page->rmap )
+    return 0;
+
+  for(slot = page->rmap; slot; slot = slot->next) {
+    if( NULL == slot->pte )
+      return 0;
+
+    pte_page = (PTE *)((unsigned long)slot->pte & ~PAGE_MASK);
+    if( 1 != kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].refcount )
+      return 0;
+
+    if( slot->pte->ACCESSED || PTE_AGE(slot->pte) < VMM_KSM_MIN_AGE )
+      return 0;
+    nr_slots++;
+  }
+
+  //-- the kernel, the image cache or an exec holds it otherwise --//
+  return nr_slots == page->refcount;
+}
+
+
+/** @function  ksm_merge
+ *  @brief     This function points every PTE of a frame at an identical
+ *             frame and frees it
+ *  @param     keep - frame that stays
+ *  @param     pfn  - frame that goes
+ *  @note      called with preemption disabled
+ *  @return    void
+ */
+
+static void ksm_merge(PFN keep,PFN pfn) {
+  vmm_rmap *slot;
+  vmm_rmap *last = NULL;
+  int       nr_slots = 0;
+
+  for(slot = kernel_vmm.m_pages[keep].rmap; slot; slot = slot->next) {
+    if( slot->pte->RW ) {
+      slot->pte->RW = 0;
+      vmm_rmap_flush_slot(slot->pte);
+    }
+  }
+
+  for(slot = kernel_vmm.m_pages[pfn].rmap; slot; slot = slot->next) {
+    vmm_getref_user_page(keep);
+    slot->pte->ADDRESS = keep;
+    slot->pte->RW      = 0;
+    vmm_rmap_flush_slot(slot->pte);
+    last = slot;
+    nr_slots++;
+  }
+
+  //-- the slots move over to the frame they now map as they are --//
+  last->next = kernel_vmm.m_pages[keep].rmap;
+  kernel_vmm.m_pages[keep].rmap = kernel_vmm.m_pages[pfn].rmap;
+  kernel_vmm.m_pages[pfn].rmap  = NULL;
+
+  while( nr_slots-- )
+    vmm_putref_user_page(pfn);
+}
+
+
+/** @function  ksm_merge_zero
+ *  @brief     This function points every PTE of a frame of zeroes at
+ *             the zero frame and frees it
+ *  @param     pfn - frame that goes
+ *  @note      called with preemption disabled
+ *  @return    void
+ */
+
+static void ksm_merge_zero(PFN pfn) {
+  vmm_rmap *slot;
+  int       nr_slots;
+
+  for(slot = kernel_vmm.m_pages[pfn].rmap; slot; slot = slot->next) {
+    vmm_getref_user_page(kernel_vmm.zero_pfn);
+    slot->pte->ADDRESS = kernel_vmm.zero_pfn;
+    slot->pte->RW      = 0;
+    vmm_rmap_flush_slot(slot->pte);
+  }
+
+  //-- the zero frame keeps no reverse mappings --//
+  nr_slots = vmm_rmap_detach(pfn);
+  while( nr_slots-- )
+    vmm_putref_user_page(pfn);
+}
+
+
+/** @function  ksm_scan_frame
+ *  @brief     This function merges a frame into an identical one if
+ *             there is one, and remembers it otherwise
+ *  @param     pfn - user frame under the cursor
+ *  @return    -1 if the frame was not hashed; 1 if it was merged;
+ *             0 otherwise
+ */
+
+static int ksm_scan_frame(PFN pfn) {
+  uint32_t hash;
+  uint32_t eflags;
+  PFN      other;
+  int      bucket;
+  int      zero;
+  int      ret = 0;
+
+  eflags = disable_preemption();
+  if( !ksm_candidate(pfn) ) {
+    enable_preemption(eflags);
+    return -1;
+  }
+
+  hash = vmm_hash_user_page(pfn,&zero);
+  if( zero ) {
+    ksm_merge_zero(pfn);
+    kernel_vmm.ksm_zero_merges++;
+    ret = 1;
+  }
+  else {
+    bucket = hash % VMM_KSM_BUCKETS;
+    other  = ksm_frames[bucket];
+    if( PFN_NULL != other && pfn != other && hash == ksm_hashes[bucket] &&
+	ksm_candidate(other) && vmm_same_user_pages(other,pfn) ) {
+      ksm_merge(other,pfn);
+      kernel_vmm.ksm_merges++;
+      ret = 1;
+    }
+    else {
+      ksm_frames[bucket] = pfn;
+      ksm_hashes[bucket] = hash;
+    }
+  }
+  enable_preemption(eflags);
+
+  return ret;
+}
+
+
+/** @function  vmm_ksm_scan
+ *  @brief     This function moves the cursor over the next frames,
+ *             hashing at most budget of them
+ *  @param     budget - frames to hash
+ *  @note      called by the idle thread
+ *  @return    number of frames freed
+ */
+
+int vmm_ksm_scan(int budget) {
+  int looked;
+  int freed = 0;
+  int ret;
+
+  for(looked = 0; looked < VMM_KSM_LOOK && budget > 0; looked++) {
+    ret = ksm_scan_frame(ksm_cursor);
+    if( ret >= 0 )
+      budget--;
+    if( ret > 0 )
+      freed++;
+
+    if( ++ksm_cursor >= kernel_vmm.swap_disk_base ) {
+      ksm_cursor = USER_FIRST_PFN;
+      kernel_vmm.ksm_sweeps++;
+    }
+  }
+
+  return freed;
+}
@@ -0,0 +1,116 @@
+/** @file     vmm_kstack.c
+ *  @brief    This file contains the kernel stacks of forked threads
+ *
+ *            Stacks come from the kstack object cache, 8K aligned so
+ *            CURRENT_THREAD finds the kthread at the bottom. A reused
+ *            stack only has its kthread header cleared; everything
+ *            above it is written by the frames thread_fork sets up
+ *            before it is read.
+ *
+ *            A vanishing thread cannot free the stack it runs on. It
+ *            puts itself on the dead list with preemption disabled and
+ *            switches away without being made runnable again, so by the
+ *            time any other thread sees it on the list it will never
+ *            run again. The list is emptied by the next thread_fork and
+ *            by the idle thread.
+ *
+ *            A tid is the address of its thread, so it may outlive the
+ *            stack it points into. Threads leave the live thread list
+ *            (see thread_lookup) before their stacks reach the dead list,
+ *            and system calls only follow tids found on it.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  vmm_kstack_alloc
+ *  @brief     This function allocates the kernel stack of a new thread
+ *  @note      may block on malloc
+ *  @return    stack with a cleared kthread at its bottom; NULL if out of
+ *             memory
+ */
+
+kthread *vmm_kstack_alloc(void) {
+  kthread *thread;
+
+  vmm_kstack_reap();
+
+  thread = vmm_cache_alloc(&kernel_vmm.kstack_cache);
+  if( thread )
+    memset(thread,0,sizeof(*thread));
+  return thread;
+}
+
+
+/** @function  vmm_kstack_free
+ *  @brief     This function frees the kernel stack of a thread that is
+ *             not running
+ *  @param     thread - thread at the bottom of the stack
+ *  @note      may block on malloc
+ *  @return    void
+ */
+
+void vmm_kstack_free(kthread *thread) {
+  assert( thread != CURRENT_THREAD );
+  vmm_cache_free(&kernel_vmm.kstack_cache,thread);
+}
+
+
+/** @function  vmm_kstack_free_self
+ *  @brief     This function puts the running thread's stack on the dead
+ *             list to be freed once it is switched away from
+ *  @note      called with preemption disabled by a thread that goes on
+ *             to schedule(CURRENT_NOT_RUNNABLE) without enabling it
+ *  @return    void
+ */
+
+void vmm_kstack_free_self(void) {
+  kthread *thread = CURRENT_THREAD;
+
+  thread->kstack_dead_next = kernel_vmm.kstack_dead;
+  kernel_vmm.kstack_dead   = thread;
+}
+
+
+/** @function  vmm_kstack_reap
+ *  @brief     This function frees the stacks of threads that vanished
+ *  @note      may block on malloc
+ *  @return    number of stacks freed
+ */
+
+int vmm_kstack_reap(void) {
+  kthread *dead;
+  kthread *next;
+  uint32_t eflags;
+  int      nr_reaped = 0;
+
+  //-- whoever runs this is not on the list; they all switched away --//
+  eflags = disable_preemption();
+  dead = kernel_vmm.kstack_dead;
+  kernel_vmm.kstack_dead = NULL;
+  enable_preemption(eflags);
+
+  for( ; dead; dead = next, nr_reaped++) {
+    next = dead->kstack_dead_next;
+    vmm_kstack_free(dead);
+  }
+
+  if( nr_reaped ) {
+    eflags = disable_preemption();
+    kernel_vmm.kstack_reaped += nr_reaped;
+    enable_preemption(eflags);
+  }
+  return nr_reaped;
+}
@@ -0,0 +1,384 @@
+/** @file     vmm_range_tree.c
+ *  @brief    This file contains the per task interval tree of vm ranges
+ *
+ *            User vm_range nodes stay on the vm_ranges_head list for
+ *            iteration and are also linked into an AVL tree ordered by
+ *            (start, node address). Every node caches the largest range
+ *            end found in its subtree so point and overlap queries can
+ *            skip whole subtrees, which keeps lookups O(log n) even
+ *            though ELF sections may share a page and overlap.
+ *
+ *            The kernel range (vm_range_kernel) is never put in the tree.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <stddef.h>
+#include <assert.h>
+
+#include <kern_common.h>
+
+
+#define RANGE_END(range)   ((range)->start + (range)->len)
+#define TREE_HEIGHT(node)  ((node) ? (node)->tree_height : 0)
+
+
+/** @function  range_key_less
+ *  @brief     This function orders two nodes by start; ties on address
+ */
+
+static int range_key_less(vm_range *a,vm_range *b) {
+  if( a->start != b->start )
+    return a->start < b->start;
+  return a < b;
+}
+
+
+/** @function  range_tree_update
+ *  @brief     This function recomputes the cached height and max_end
+ *  @param     node - node whose children are up to date
+ *  @return    void
+ */
+
+static void range_tree_update(vm_range *node) {
+  int lh = TREE_HEIGHT(node->tree_left);
+  int rh = TREE_HEIGHT(node->tree_right);
+
+  node->tree_height  = 1 + ( lh > rh ? lh : rh );
+  node->tree_max_end = RANGE_END(node);
+
+  if( node->tree_left && node->tree_left->tree_max_end > node->tree_max_end )
+    node->tree_max_end = node->tree_left->tree_max_end;
+  if( node->tree_right && node->tree_right->tree_max_end > node->tree_max_end )
+    node->tree_max_end = node->tree_right->tree_max_end;
+}
+
+
+static vm_range *range_tree_rotate_right(vm_range *node) {
+  vm_range *pivot = node->tree_left;
+
+  node->tree_left   = pivot->tree_right;
+  pivot->tree_right = node;
+  range_tree_update(node);
+  range_tree_update(pivot);
+  return pivot;
+}
+
+
+static vm_range *range_tree_rotate_left(vm_range *node) {
+  vm_range *pivot = node->tree_right;
+
+  node->tree_right = pivot->tree_left;
+  pivot->tree_left = node;
+  range_tree_update(node);
+  range_tree_update(pivot);
+  return pivot;
+}
+
+
+/** @function  range_tree_balance
+ *  @brief     This function restores the AVL invariant at a node
+ *  @param     node - root of a subtree whose children are balanced
+ *  @return    new root of the subtree
+ */
+
+static vm_range *range_tree_balance(vm_range *node) {
+  int balance;
+
+  range_tree_update(node);
+  balance = TREE_HEIGHT(node->tree_left) - TREE_HEIGHT(node->tree_right);
+
+  if( balance > 1 ) {
+    if( TREE_HEIGHT(node->tree_left->tree_left) <
+	TREE_HEIGHT(node->tree_left->tree_right) )
+      node->tree_left = range_tree_rotate_left(node->tree_left);
+    return range_tree_rotate_right(node);
+  }
+
+  if( balance < -1 ) {
+    if( TREE_HEIGHT(node->tree_right->tree_right) <
+	TREE_HEIGHT(node->tree_right->tree_left) )
+      node->tree_right = range_tree_rotate_right(node->tree_right);
+    return range_tree_rotate_left(node);
+  }
+
+  return node;
+}
+
+
+static vm_range *range_tree_insert(vm_range *root,vm_range *node) {
+  if( NULL == root )
+    return node;
+
+  if( range_key_less(node,root) )
+    root->tree_left  = range_tree_insert(root->tree_left,node);
+  else
+    root->tree_right = range_tree_insert(root->tree_right,node);
+
+  return range_tree_balance(root);
+}
+
+
+/** @function  range_tree_remove_min
+ *  @brief     This function unlinks the leftmost node of a subtree
+ *  @param     root - subtree root
+ *  @param     min  - placeholder for the unlinked node
+ *  @return    new root of the subtree
+ */
+
+static vm_range *range_tree_remove_min(vm_range *root,vm_range **min) {
+  if( NULL == root->tree_left ) {
+    *min = root;
+    return root->tree_right;
+  }
+
+  root->tree_left = range_tree_remove_min(root->tree_left,min);
+  return range_tree_balance(root);
+}
+
+
+static vm_range *range_tree_remove(vm_range *root,vm_range *node) {
+  vm_range *successor;
+
+  //-- node must be in the tree --//
+  assert( NULL != root );
+
+  if( root == node ) {
+    if( NULL == node->tree_left )
+      return node->tree_right;
+    if( NULL == node->tree_right )
+      return node->tree_left;
+
+    node->tree_right = range_tree_remove_min(node->tree_right,&successor);
+    successor->tree_left  = node->tree_left;
+    successor->tree_right = node->tree_right;
+    return range_tree_balance(successor);
+  }
+
+  if( range_key_less(node,root) )
+    root->tree_left  = range_tree_remove(root->tree_left,node);
+  else
+    root->tree_right = range_tree_remove(root->tree_right,node);
+
+  return range_tree_balance(root);
+}
+
+
+/** @function  vmm_range_tree_insert
+ *  @brief     This function links a user range into the task's tree
+ *  @param     vm    - pointer to the task's VM
+ *  @param     range - range node already on the vm_ranges_head list
+ *  @return    void
+ */
+
+void vmm_range_tree_insert(struct task_vm *vm,vm_range *range) {
+  range->tree_left   = NULL;
+  range->tree_right  = NULL;
+  range_tree_update(range);
+  vm->vm_range_root = range_tree_insert(vm->vm_range_root,range);
+}
+
+
+/** @function  vmm_range_tree_remove
+ *  @brief     This function unlinks a user range from the task's tree
+ *  @param     vm    - pointer to the task's VM
+ *  @param     range - range node in the tree
+ *  @return    void
+ */
+
+void vmm_range_tree_remove(struct task_vm *vm,vm_range *range) {
+  vm->vm_range_root = range_tree_remove(vm->vm_range_root,range);
+  range->tree_left  = NULL;
+  range->tree_right = NULL;
+}
+
+
+/** @function  vmm_range_tree_overlap
+ *  @brief     This function finds the lowest range that overlaps [start,end)
+ *  @param     vm    - pointer to the task's VM
+ *  @param     start - first address of the interval
+ *  @param     end   - first address past the interval
+ *  @return    overlapping range; NULL if the interval is free
+ */
+
+vm_range *vmm_range_tree_overlap(struct task_vm *vm,
+				 unsigned long start,
+				 unsigned long end) {
+  vm_range *node  = vm->vm_range_root;
+  vm_range *found = NULL;
+
+  while( node ) {
+    //-- nothing in the left subtree ends past start --//
+    if( node->tree_left && node->tree_left->tree_max_end > start ) {
+      node = node->tree_left;
+      continue;
+    }
+
+    if( node->start < end && RANGE_END(node) > start ) {
+      found = node;
+      break;
+    }
+
+    //-- everything to the right starts too late --//
+    if( node->start >= end )
+      break;
+
+    node = node->tree_right;
+  }
+
+  return found;
+}
+
+
+/** @function  range_tree_collect
+ *  @brief     This function gathers the nodes of a subtree that overlap
+ *             [start,end), in key order
+ *  @return    number of nodes in ranges now
+ */
+
+static int range_tree_collect(vm_range *node,
+			      unsigned long start,
+			      unsigned long end,
+			      vm_range **ranges,
+			      int nr,
+			      int max) {
+  //-- nothing in this subtree ends past start --//
+  if( NULL == node || node->tree_max_end <= start )
+    return nr;
+
+  nr = range_tree_collect(node->tree_left,start,end,ranges,nr,max);
+
+  //-- neither this node nor anything to its right starts in time --//
+  if( node->start >= end )
+    return nr;
+
+  if( RANGE_END(node) > start && nr < max )
+    ranges[nr++] = node;
+
+  return range_tree_collect(node->tree_right,start,end,ranges,nr,max);
+}
+
+
+/** @function  vmm_range_tree_overlap_all
+ *  @brief     This function finds every range that overlaps [start,end)
+ *  @param     vm     - pointer to the task's VM
+ *  @param     start  - first address of the interval
+ *  @param     end    - first address past the interval
+ *  @param     ranges - placeholder for the ranges, lowest start first
+ *  @param     max    - room in ranges; further ranges are left out
+ *  @return    number of ranges found
+ */
+
+int vmm_range_tree_overlap_all(struct task_vm *vm,
+			       unsigned long start,
+			       unsigned long end,
+			       vm_range **ranges,
+			       int max) {
+  return range_tree_collect(vm->vm_range_root,start,end,ranges,0,max);
+}
+
+
+/** @function  vmm_range_tree_lookup
+ *  @brief     This function finds a range containing the address
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address in question
+ *  @return    range containing address; NULL if none does
+ */
+
+vm_range *vmm_range_tree_lookup(struct task_vm *vm,unsigned long address) {
+  return vmm_range_tree_overlap(vm,address,address + 1);
+}
+
+
+/** @function  vmm_range_tree_find_start
+ *  @brief     This function finds the range that starts exactly at start
+ *  @param     vm    - pointer to the task's VM
+ *  @param     start - start address of the range
+ *  @return    the range; NULL if no range starts there
+ */
+
+vm_range *vmm_range_tree_find_start(struct task_vm *vm,unsigned long start) {
+  vm_range *node  = vm->vm_range_root;
+  vm_range *found = NULL;
+
+  //-- leftmost node with the key, in case of ties --//
+  while( node ) {
+    if( start <= node->start ) {
+      if( start == node->start )
+	found = node;
+      node = node->tree_left;
+    }
+    else
+      node = node->tree_right;
+  }
+
+  return found;
+}
+
+
+/** @function  vmm_range_tree_next
+ *  @brief     This function finds the neighbour range above an address
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address in question
+ *  @return    range with the lowest start >= address; NULL if none
+ */
+
+vm_range *vmm_range_tree_next(struct task_vm *vm,unsigned long address) {
+  vm_range *node  = vm->vm_range_root;
+  vm_range *found = NULL;
+
+  while( node ) {
+    if( node->start >= address ) {
+      found = node;
+      node  = node->tree_left;
+    }
+    else
+      node = node->tree_right;
+  }
+
+  return found;
+}
+
+
+/** @function  vmm_range_tree_prev
+ *  @brief     This function finds the neighbour range below an address
+ *  @param     vm      - pointer to the task's VM
+ *  @param     address - user address in question
+ *  @return    range with the highest start < address; NULL if none
+ */
+
+vm_range *vmm_range_tree_prev(struct task_vm *vm,unsigned long address) {
+  vm_range *node  = vm->vm_range_root;
+  vm_range *found = NULL;
+
+  while( node ) {
+    if( node->start < address ) {
+      found = node;
+      node  = node->tree_right;
+    }
+    else
+      node = node->tree_left;
+  }
+
+  return found;
+}
+
+
+/** @function  vmm_range_tree_resize
+ *  @brief     This function moves the bounds of a range in the tree
+ *  @param     vm    - pointer to the task's VM
+ *  @param     range - range node in the tree
+ *  @param     start - new start of the range
+ *  @param     len   - new length of the range
+ *  @return    void
+ */
+
+void vmm_range_tree_resize(struct task_vm *vm,
+			   vm_range *range,
+			   unsigned long start,
+			   unsigned long len) {
+  vmm_range_tree_remove(vm,range);
+  range->start = start;
+  range->len   = len;
+  vmm_range_tree_insert(vm,range);
+}
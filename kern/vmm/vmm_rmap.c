@@ -0,0 +1,350 @@
+/** @file     vmm_rmap.c
+ *  @brief    This file contains the reverse mappings from frames to the
+ *            page table entries that map them
+ *
+ *            Every user frame keeps a chain of the PTE slots that map it.
+ *            A page table can itself be shared by several VMs after fork,
+ *            so a slot does not name a task; the page table's own m_page
+ *            keeps a chain of the VMs whose PDEs point at it along with
+ *            the 4MB address they map it at. Resolving a frame is one
+ *            step through each chain. A 4MB page has no page table; the
+ *            VMs mapping it whole are chained on its first frame.
+ *
+ *            The zero frame is mapped by nearly every task and is never
+ *            reclaimed, so it is not tracked.
+ *
+ *            Entries come from malloc, which may block. Callers that are
+ *            not allowed to fail reserve the entries they need up front
+ *            and link them once the page tables are edited. Entries of
+ *            frames dropped by swap-out, which runs with preemption off,
+ *            are parked on a spare list and handed out again first.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+//-- records vmm_rmap_dump prints --//
+#define RMAP_DUMP_MAX 16
+
+
+/** @function  vmm_rmap_reserve
+ *  @brief     This function sets aside rmap entries for a caller that
+ *             cannot fail once it starts editing page tables
+ *  @param     pool - chain of entries to add to
+ *  @param     nr   - number of entries to add
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when out of memory -
+ *             entries added so far stay on the pool
+ */
+
+KERN_RET_CODE vmm_rmap_reserve(vmm_rmap **pool,int nr) {
+  vmm_rmap *entry;
+  uint32_t  eflags;
+  int       i;
+
+  for(i = 0; i < nr; i++) {
+    eflags = disable_preemption();
+    entry = kernel_vmm.rmap_spare;
+    if( entry )
+      kernel_vmm.rmap_spare = entry->next;
+    enable_preemption(eflags);
+
+    if( !entry )
+      entry = malloc(sizeof(*entry));
+    if( !entry )
+      return KERN_NO_MEM;
+
+    entry->next = *pool;
+    *pool = entry;
+  }
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_rmap_release
+ *  @brief     This function gives back the unused entries of a pool
+ *  @param     pool - chain of entries; empty on return
+ *  @return    void
+ */
+
+void vmm_rmap_release(vmm_rmap **pool) {
+  vmm_rmap *entry;
+
+  while( *pool ) {
+    entry = *pool;
+    *pool = entry->next;
+    free(entry);
+  }
+}
+
+
+/** @function  vmm_rmap_link
+ *  @brief     This function records a mapping using a reserved entry
+ *  @param     pool    - reserved entries
+ *  @param     pfn     - frame being mapped
+ *  @param     vm      - owner of a page table or 4MB page; NULL for a slot
+ *  @param     address - 4MB aligned user address of an owner; 0 for a slot
+ *  @param     pte     - slot mapping a user frame; NULL for an owner
+ *  @return    void
+ */
+
+void vmm_rmap_link(vmm_rmap **pool,
+		   PFN pfn,
+		   struct task_vm *vm,
+		   unsigned long address,
+		   PTE *pte) {
+  vmm_rmap *entry;
+  uint32_t  eflags;
+
+  if( kernel_vmm.zero_pfn == pfn )
+    return;
+
+  assert( *pool );
+  entry = *pool;
+  *pool = entry->next;
+
+  entry->vm      = vm;
+  entry->address = address;
+  entry->pte     = pte;
+
+  //-- shared frames are linked and unlinked by several tasks --//
+  eflags = disable_preemption();
+  entry->next = kernel_vmm.m_pages[pfn].rmap;
+  kernel_vmm.m_pages[pfn].rmap = entry;
+  kernel_vmm.rmap_entries++;
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_rmap_add
+ *  @brief     This function records a mapping
+ *  @param     pfn     - frame being mapped
+ *  @param     vm      - owner of a page table or 4MB page; NULL for a slot
+ *  @param     address - 4MB aligned user address of an owner; 0 for a slot
+ *  @param     pte     - slot mapping a user frame; NULL for an owner
+ *  @return    KERN_SUCCESS on success; KERN_NO_MEM when out of memory
+ */
+
+KERN_RET_CODE vmm_rmap_add(PFN pfn,
+			   struct task_vm *vm,
+			   unsigned long address,
+			   PTE *pte) {
+  vmm_rmap *pool = NULL;
+
+  if( kernel_vmm.zero_pfn == pfn )
+    return KERN_SUCCESS;
+
+  if( KERN_SUCCESS != vmm_rmap_reserve(&pool,1) )
+    return KERN_NO_MEM;
+
+  vmm_rmap_link(&pool,pfn,vm,address,pte);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_rmap_remove
+ *  @brief     This function forgets a mapping recorded by vmm_rmap_add
+ *             or vmm_rmap_link; it has to be there
+ *  @param     pfn     - frame no longer mapped
+ *  @param     vm      - owner of a page table or 4MB page; NULL for a slot
+ *  @param     address - 4MB aligned user address of an owner; 0 for a slot
+ *  @param     pte     - slot that mapped a user frame; NULL for an owner
+ *  @return    void
+ */
+
+void vmm_rmap_remove(PFN pfn,
+		     struct task_vm *vm,
+		     unsigned long address,
+		     PTE *pte) {
+  vmm_rmap *prev = NULL;
+  vmm_rmap *entry;
+  uint32_t  eflags;
+
+  if( kernel_vmm.zero_pfn == pfn )
+    return;
+
+  eflags = disable_preemption();
+  for(entry = kernel_vmm.m_pages[pfn].rmap; entry; entry = entry->next) {
+    if( pte ? entry->pte == pte :
+	( NULL == entry->pte && entry->vm == vm && entry->address == address ) )
+      break;
+    prev = entry;
+  }
+  assert( entry );
+  if( prev )
+    prev->next = entry->next;
+  else
+    kernel_vmm.m_pages[pfn].rmap = entry->next;
+  kernel_vmm.rmap_entries--;
+  enable_preemption(eflags);
+
+  free(entry);
+}
+
+
+/** @function  vmm_rmap_detach
+ *  @brief     This function forgets every mapping of a frame at once
+ *  @param     pfn - frame no longer mapped anywhere
+ *  @note      called with preemption disabled; the entries are kept
+ *             on the spare list rather than freed
+ *  @return    number of mappings forgotten
+ */
+
+int vmm_rmap_detach(PFN pfn) {
+  vmm_rmap *entry;
+  int       nr = 0;
+
+  while( NULL != ( entry = kernel_vmm.m_pages[pfn].rmap ) ) {
+    kernel_vmm.m_pages[pfn].rmap = entry->next;
+    entry->next = kernel_vmm.rmap_spare;
+    kernel_vmm.rmap_spare = entry;
+    nr++;
+  }
+  kernel_vmm.rmap_entries -= nr;
+  return nr;
+}
+
+
+/** @function  vmm_rmap_flush_slot
+ *  @brief     This function drops the TLB entry of a PTE slot in a page
+ *             table with a single owner
+ *  @param     pte - the slot
+ *  @return    void
+ */
+
+void vmm_rmap_flush_slot(PTE *pte) {
+  PTE      *pte_page = (PTE *)((unsigned long)pte & ~PAGE_MASK);
+  vmm_rmap *owner    = kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].rmap;
+
+  if( owner )
+    vmm_tlb_flush_page(owner->vm,owner->address + ( pte - pte_page ) * PAGE_SIZE);
+}
+
+
+/** @function  rmap_record
+ *  @brief     This function fills in one mapping found by vmm_rmap_query
+ *  @param     buf      - kernel records to fill
+ *  @param     count    - size of buf
+ *  @param     nr       - mappings found before this one
+ *  @param     vm       - VM mapping the frame
+ *  @param     address  - user address of the mapping
+ *  @param     writable - 1 if a write would not fault
+ *  @return    void
+ */
+
+static void rmap_record(rmap_mapping_t *buf,
+			int count,
+			int nr,
+			struct task_vm *vm,
+			unsigned long address,
+			int writable) {
+  ktask *task;
+
+  if( nr >= count )
+    return;
+
+  //-- the VM is embedded in its task; tasks are named by their first thread --//
+  task = (ktask *)((char *)vm - (unsigned long)&((ktask *)0)->vm);
+  buf[nr].tid      = (int)&task->initial_thread;
+  buf[nr].address  = address;
+  buf[nr].writable = writable;
+}
+
+
+/** @function  vmm_rmap_query
+ *  @brief     This function finds every task and address mapping a frame
+ *  @param     pfn   - user frame
+ *  @param     buf   - kernel records to fill; may be NULL if count is 0.
+ *                     Filled with preemption disabled, so never a user
+ *                     buffer; callers copy the records out afterwards
+ *  @param     count - size of buf
+ *  @return    number of mappings; may exceed count, only count of them
+ *             are filled in. Always 0 for the zero frame
+ */
+
+int vmm_rmap_query(PFN pfn,rmap_mapping_t *buf,int count) {
+  vmm_rmap *slot;
+  vmm_rmap *owner;
+  PTE      *pte_page;
+  PDE      *pde;
+  PFN       head;
+  unsigned long address;
+  uint32_t  eflags;
+  int       nr = 0;
+
+  eflags = disable_preemption();
+
+  //-- 4K mappings; a slot is mapped by every owner of its page table --//
+  for(slot = kernel_vmm.m_pages[pfn].rmap; slot; slot = slot->next) {
+    if( NULL == slot->pte )
+      continue;
+
+    pte_page = (PTE *)((unsigned long)slot->pte & ~PAGE_MASK);
+    for(owner = kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].rmap;
+	owner;
+	owner = owner->next) {
+      address = owner->address + ( slot->pte - pte_page ) * PAGE_SIZE;
+      pde     = vmm_get_pde(owner->vm,address);
+      rmap_record(buf,count,nr++,owner->vm,address,pde->RW && slot->pte->RW);
+    }
+  }
+
+  //-- 4MB mappings hang off the first frame of the block --//
+  head = pfn & ~(PTE_PER_PAGE - 1);
+  if( head >= USER_FIRST_PFN ) {
+    for(owner = kernel_vmm.m_pages[head].rmap; owner; owner = owner->next) {
+      if( NULL != owner->pte )
+	continue;
+
+      address = owner->address + ( pfn - head ) * PAGE_SIZE;
+      pde     = vmm_get_pde(owner->vm,address);
+      rmap_record(buf,count,nr++,owner->vm,address,pde->RW);
+    }
+  }
+
+  enable_preemption(eflags);
+  return nr;
+}
+
+
+/** @function  vmm_rmap_dump
+ *  @brief     This function prints who maps a frame; meant to be called
+ *             from the debugger while looking into memory pressure
+ *  @param     pfn - user frame
+ *  @return    void
+ */
+
+void vmm_rmap_dump(PFN pfn) {
+  rmap_mapping_t mappings[RMAP_DUMP_MAX];
+  int nr;
+  int i;
+
+  if( pfn < USER_FIRST_PFN || pfn >= (PFN)kernel_vmm.nr_physical_pages ) {
+    lprintf("rmap: 0x%x is not a user frame",pfn);
+    return;
+  }
+
+  nr = vmm_rmap_query(pfn,mappings,RMAP_DUMP_MAX);
+  lprintf("rmap: frame 0x%x refcount %d mapped %d times%s",
+	  pfn,
+	  kernel_vmm.m_pages[pfn].refcount,
+	  nr,
+	  kernel_vmm.zero_pfn == pfn ? " (zero frame; not tracked)" : "");
+
+  for(i = 0; i < nr && i < RMAP_DUMP_MAX; i++)
+    lprintf("rmap:   tid 0x%x address 0x%x %s",
+	    mappings[i].tid,
+	    mappings[i].address,
+	    mappings[i].writable ? "rw" : "ro");
+}
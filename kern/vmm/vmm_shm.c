@@ -0,0 +1,255 @@
+/** @file     vmm_shm.c
+ *  @brief    This file contains the shared memory segments
+ *
+ *            A segment is a run of frames that every task attaching it
+ *            maps at an address of its own choosing, so bytes written by
+ *            one task are read by the others without a copy. The frames
+ *            are allocated and zeroed when the segment is created; the
+ *            segment holds one reference on each of them until it goes.
+ *
+ *            An attachment is a VM_RANGE_SHARED range naming the
+ *            segment. Its pages are mapped on first touch like those of
+ *            any other range, but always to the segment's own frame and
+ *            always writable: a write after fork makes the PTE writable
+ *            again instead of breaking copy on write. Frames that stay
+ *            referenced by a segment are passed over by swap and page
+ *            merging, which only take frames every reference of which is
+ *            a mapping.
+ *
+ *            Every range naming a segment holds a reference on it, and so
+ *            does a lookup by id until the caller drops it. Fork copies
+ *            the ranges, so children share the parent's segments; exec,
+ *            exit and shm_detach drop them. The last reference frees the
+ *            segment and gives its frames back.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  shm_free
+ *  @brief     This function gives back the frames of a segment nobody
+ *             refers to any more
+ *  @param     shm - segment; off the segment list
+ *  @note      may block on malloc
+ *  @return    void
+ */
+
+static void shm_free(vmm_shm *shm) {
+  int i;
+
+  for(i = 0; i < shm->nr_pages; i++)
+    vmm_putref_user_page(shm->frames[i]);
+
+  free(shm->frames);
+  free(shm);
+}
+
+
+/** @function  vmm_shm_create
+ *  @brief     This function creates a segment of zeroed frames
+ *  @param     nr_pages - size of the segment in pages
+ *  @param     pshm     - placeholder for the segment; the caller holds
+ *                        a reference on it
+ *  @return    KERN_SUCCESS on success; KERN_ERROR_GENERIC on a bad size
+ *             or when there are too many segments; KERN_NO_MEM when out
+ *             of memory
+ */
+
+KERN_RET_CODE vmm_shm_create(int nr_pages,vmm_shm **pshm) {
+  KERN_RET_CODE ret = KERN_NO_MEM;
+  vmm_shm      *shm;
+  uint32_t      eflags;
+  int           i = 0;
+
+  if( nr_pages <= 0 || nr_pages > VMM_SHM_MAX_PAGES )
+    return KERN_ERROR_GENERIC;
+
+  //-- claim a slot first; allocating below may block --//
+  eflags = disable_preemption();
+  if( kernel_vmm.shm_nr_segments >= VMM_SHM_MAX_SEGMENTS ) {
+    enable_preemption(eflags);
+    return KERN_ERROR_GENERIC;
+  }
+  kernel_vmm.shm_nr_segments++;
+  enable_preemption(eflags);
+
+  shm = malloc(sizeof(vmm_shm));
+  if( NULL == shm )
+    goto error;
+
+  shm->frames = malloc(nr_pages * sizeof(PFN));
+  if( NULL == shm->frames )
+    goto error;
+
+  //-- every frame up front; a fault never has to find one --//
+  for( ; i < nr_pages; i++) {
+    ret = vmm_get_zeroed_user_page(&shm->frames[i]);
+    if( KERN_SUCCESS != ret )
+      goto error;
+  }
+  shm->nr_pages = nr_pages;
+  shm->refs     = 1;
+
+  eflags = disable_preemption();
+  //-- ids are positive; shm_create returns negative errors --//
+  if( ++kernel_vmm.shm_next_id <= 0 )
+    kernel_vmm.shm_next_id = 1;
+  shm->id   = kernel_vmm.shm_next_id;
+  shm->next = kernel_vmm.shm_segments;
+  kernel_vmm.shm_segments = shm;
+  kernel_vmm.shm_frames  += nr_pages;
+  enable_preemption(eflags);
+
+  *pshm = shm;
+  return KERN_SUCCESS;
+
+error:
+  if( shm ) {
+    shm->nr_pages = i;
+    if( shm->frames )
+      shm_free(shm);
+    else
+      free(shm);
+  }
+
+  eflags = disable_preemption();
+  kernel_vmm.shm_nr_segments--;
+  enable_preemption(eflags);
+  return ret;
+}
+
+
+/** @function  vmm_shm_find
+ *  @brief     This function looks up a segment by id
+ *  @param     id - id handed out by shm_create
+ *  @return    the segment with a reference taken for the caller; NULL
+ *             if there is none by that id
+ */
+
+vmm_shm *vmm_shm_find(int id) {
+  vmm_shm *shm;
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  for(shm = kernel_vmm.shm_segments; shm; shm = shm->next) {
+    if( id == shm->id ) {
+      shm->refs++;
+      break;
+    }
+  }
+  enable_preemption(eflags);
+
+  return shm;
+}
+
+
+/** @function  vmm_shm_get
+ *  @brief     This function takes a reference on a segment
+ *  @param     shm - segment the caller already holds a reference on
+ *  @return    void
+ */
+
+void vmm_shm_get(vmm_shm *shm) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  assert( shm->refs > 0 );
+  shm->refs++;
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_shm_put
+ *  @brief     This function drops a reference on a segment; the last
+ *             one frees it
+ *  @param     shm - segment
+ *  @note      may block on malloc
+ *  @return    void
+ */
+
+void vmm_shm_put(vmm_shm *shm) {
+  vmm_shm **link;
+  uint32_t  eflags;
+
+  eflags = disable_preemption();
+  assert( shm->refs > 0 );
+  if( --shm->refs ) {
+    enable_preemption(eflags);
+    return;
+  }
+
+  //-- nobody can look it up once it is off the list --//
+  for(link = &kernel_vmm.shm_segments; *link != shm; link = &(*link)->next)
+    assert( *link );
+  *link = shm->next;
+  kernel_vmm.shm_nr_segments--;
+  kernel_vmm.shm_frames -= shm->nr_pages;
+  enable_preemption(eflags);
+
+  shm_free(shm);
+}
+
+
+/** @function  vmm_shm_attach
+ *  @brief     This function maps a segment into a task's VM. Pages are
+ *             mapped on first touch
+ *  @param     vm    - pointer to the task's VM
+ *  @param     shm   - segment the caller holds a reference on; the new
+ *                     range takes one of its own
+ *  @param     start - page aligned user address
+ *  @return    KERN_SUCCESS on success; KERN_PAGE_ERR if the segment
+ *             does not fit there; vmm_install_range error otherwise
+ */
+
+KERN_RET_CODE vmm_shm_attach(struct task_vm *vm,
+			     vmm_shm *shm,
+			     unsigned long start) {
+  vm_range range;
+  unsigned long len = shm->nr_pages * PAGE_SIZE;
+
+  if( start < USER_MEM_START || start + len <= start )
+    return KERN_PAGE_ERR;
+
+  if( vmm_get_overlapping_range(vm,(void *)start,len) )
+    return KERN_PAGE_ERR;
+
+  memset(&range,0,sizeof(range));
+  range.start = start;
+  range.len   = len;
+  range.flags = VM_RANGE_SHARED;
+  range.shm   = shm;
+  return vmm_install_range(vm,&range);
+}
+
+
+/** @function  vmm_shm_detach
+ *  @brief     This function unmaps a segment from a task's VM
+ *  @param     vm    - pointer to the task's VM
+ *  @param     start - address the segment was attached at
+ *  @return    KERN_SUCCESS on success; KERN_ERROR_ADDRESS_NOT_PRESENT if
+ *             no segment is attached there; vmm_uninstall_range error
+ *             otherwise
+ */
+
+KERN_RET_CODE vmm_shm_detach(struct task_vm *vm,unsigned long start) {
+  vm_range *range;
+
+  range = vmm_range_tree_find_start(vm,start);
+  if( NULL == range || NULL == range->shm )
+    return KERN_ERROR_ADDRESS_NOT_PRESENT;
+
+  return vmm_uninstall_range(vm,range);
+}
@@ -0,0 +1,423 @@
+/** @file     vmm_swap.c
+ *  @brief    This file contains page reclamation to swap
+ *
+ *            When the frame pool runs dry a clock hand sweeps the user
+ *            frames looking for ones nobody touched since its last pass.
+ *            A frame with its accessed bits set, or that the working set
+ *            sampler saw touched in its last pass (age 0), gets them
+ *            cleared, its age moved to 1 and a second chance; one
+ *            without is written out and freed. Every
+ *            PTE that mapped it is left not present with a swap handle in
+ *            its address bits (see PTE_IS_SWAPPED), and the next fault on
+ *            it reads the page back into a fresh private frame.
+ *
+ *            Pages are kept in two tiers. A page that compresses to half
+ *            a frame or less goes to the zpool, kernel memory carved into
+ *            small chunks; mostly empty pages, the common case for heaps
+ *            and tables, cost a few bytes there. Other pages go to the
+ *            RAM disk, a region at the top of physical memory that the
+ *            buddy allocator never hands out.
+ *
+ *            The reverse mappings name the PTEs of a frame. Only frames
+ *            whose every reference is a PTE in a page table of its own
+ *            are evicted; frames pinned by the kernel, the image cache or
+ *            page tables shared after fork are passed over.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <malloc.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+#define PAGE_WORDS    (PAGE_SIZE / sizeof(uint32_t))
+#define ZPOOL_CHUNKS  (VMM_SWAP_ZPOOL_BYTES / VMM_SWAP_ZCHUNK)
+
+//-- a compressed page is a list of runs of 32 bit words, each --//
+//-- behind a 16 bit header; zero runs have no payload          --//
+#define ZRUN_ZERO     0x8000
+#define ZRUN_WORDS    0x7fff
+
+//-- handles below VMM_SWAP_DISK_PAGES are RAM disk slots; --//
+//-- the ones above index the zpool entries                 --//
+#define HANDLE_IS_DISK(handle)  ((handle) < VMM_SWAP_DISK_PAGES)
+#define HANDLE_ZENTRY(handle)   (&zentries[(handle) - VMM_SWAP_DISK_PAGES])
+
+// -- one page held compressed in the zpool -- //
+typedef struct _swap_zentry {
+  int            refcount;        //- PTEs holding the handle; 0 if unused -//
+  int            first;           //- first chunk                         -//
+  unsigned short nr_chunks;
+  unsigned short len;             //- compressed bytes                    -//
+}swap_zentry;
+
+static unsigned short disk_refs[VMM_SWAP_DISK_PAGES];
+static int            disk_hint;
+
+static char          *zpool;      //- NULL when there is no compressed tier -//
+static unsigned char  zchunk_used[ZPOOL_CHUNKS];
+static swap_zentry    zentries[VMM_SWAP_ZENTRIES];
+
+static PFN            clock_hand;
+
+//-- staging buffers; only touched with preemption disabled --//
+static uint32_t       page_buf[PAGE_WORDS];
+static char           zbuf[PAGE_SIZE / 2];
+
+
+/** @function  vmm_swap_init
+ *  @brief     This function sets aside the RAM disk at the top of
+ *             physical memory and the zpool; the RAM disk is only
+ *             taken out of machines with enough frames to spare
+ *  @note      has to run before vmm_buddy_init
+ *  @return    void
+ */
+
+void vmm_swap_init(void) {
+  kernel_vmm.swap_disk_base  = kernel_vmm.nr_physical_pages;
+  kernel_vmm.swap_disk_pages = 0;
+  if( kernel_vmm.nr_physical_pages - USER_FIRST_PFN >=
+      VMM_SWAP_DISK_MIN + VMM_SWAP_DISK_PAGES ) {
+    kernel_vmm.swap_disk_base -= VMM_SWAP_DISK_PAGES;
+    kernel_vmm.swap_disk_pages = VMM_SWAP_DISK_PAGES;
+  }
+
+  //-- without it pages simply all go to the RAM disk --//
+  zpool = smemalign(PAGE_SIZE,VMM_SWAP_ZPOOL_BYTES);
+
+  clock_hand = USER_FIRST_PFN;
+}
+
+
+/** @function  swap_compress
+ *  @brief     This function compresses a page into runs of words
+ *  @param     words - the page
+ *  @param     out   - compressed bytes
+ *  @param     max   - size of out
+ *  @return    compressed length; 0 if it does not fit in max
+ */
+
+static int swap_compress(const uint32_t *words,char *out,int max) {
+  unsigned short header;
+  int i = 0;
+  int len = 0;
+  int run;
+  int zero;
+
+  while( i < PAGE_WORDS ) {
+    zero = ( 0 == words[i] );
+    for(run = 1;
+	i + run < PAGE_WORDS && run < ZRUN_WORDS &&
+	  ( 0 == words[i + run] ) == zero;
+	run++)
+      ;
+
+    if( len + sizeof(header) + ( zero ? 0 : run * sizeof(uint32_t) ) > max )
+      return 0;
+
+    header = run | ( zero ? ZRUN_ZERO : 0 );
+    memcpy(out + len,&header,sizeof(header));
+    len += sizeof(header);
+    if( !zero ) {
+      memcpy(out + len,&words[i],run * sizeof(uint32_t));
+      len += run * sizeof(uint32_t);
+    }
+    i += run;
+  }
+  return len;
+}
+
+
+/** @function  swap_decompress
+ *  @brief     This function expands a page compressed by swap_compress
+ *  @param     in    - compressed bytes
+ *  @param     len   - compressed length
+ *  @param     words - the page
+ *  @return    void
+ */
+
+static void swap_decompress(const char *in,int len,uint32_t *words) {
+  unsigned short header;
+  int pos = 0;
+  int i = 0;
+  int run;
+
+  while( pos < len ) {
+    memcpy(&header,in + pos,sizeof(header));
+    pos += sizeof(header);
+    run  = header & ZRUN_WORDS;
+
+    if( header & ZRUN_ZERO )
+      memset(&words[i],0,run * sizeof(uint32_t));
+    else {
+      memcpy(&words[i],in + pos,run * sizeof(uint32_t));
+      pos += run * sizeof(uint32_t);
+    }
+    i += run;
+  }
+  assert( PAGE_WORDS == i );
+}
+
+
+/** @function  zpool_alloc
+ *  @brief     This function finds a run of free zpool chunks, first fit
+ *  @param     nr - number of chunks
+ *  @return    first chunk; -1 if there is no such run
+ */
+
+static int zpool_alloc(int nr) {
+  int first;
+  int run = 0;
+
+  for(first = 0; first + run < ZPOOL_CHUNKS; ) {
+    if( zchunk_used[first + run] ) {
+      first += run + 1;
+      run = 0;
+      continue;
+    }
+    if( ++run == nr )
+      return first;
+  }
+  return -1;
+}
+
+
+/** @function  swap_store
+ *  @brief     This function writes a frame out to the zpool if it
+ *             compresses well enough, else to the RAM disk
+ *  @param     pfn      - frame to write out
+ *  @param     refcount - PTEs that will hold the handle
+ *  @note      called with preemption disabled
+ *  @return    the swap handle; -1 if both tiers are full
+ */
+
+static int swap_store(PFN pfn,int refcount) {
+  swap_zentry *zentry;
+  int len;
+  int first;
+  int i;
+
+  vmm_read_user_page(pfn,0,(char *)page_buf,PAGE_SIZE);
+
+  len = zpool ? swap_compress(page_buf,zbuf,sizeof(zbuf)) : 0;
+  if( len ) {
+    for(i = 0; i < VMM_SWAP_ZENTRIES; i++)
+      if( 0 == zentries[i].refcount )
+	break;
+
+    first = -1;
+    if( i < VMM_SWAP_ZENTRIES )
+      first = zpool_alloc(( len + VMM_SWAP_ZCHUNK - 1 ) / VMM_SWAP_ZCHUNK);
+
+    if( first >= 0 ) {
+      zentry = &zentries[i];
+      zentry->refcount  = refcount;
+      zentry->first     = first;
+      zentry->nr_chunks = ( len + VMM_SWAP_ZCHUNK - 1 ) / VMM_SWAP_ZCHUNK;
+      zentry->len       = len;
+      memset(&zchunk_used[first],1,zentry->nr_chunks);
+      memcpy(zpool + first * VMM_SWAP_ZCHUNK,zbuf,len);
+
+      kernel_vmm.swap_zpages++;
+      kernel_vmm.swap_zbytes += zentry->nr_chunks * VMM_SWAP_ZCHUNK;
+      return VMM_SWAP_DISK_PAGES + i;
+    }
+  }
+
+  //-- did not compress or the zpool is full --//
+  for(i = 0; i < kernel_vmm.swap_disk_pages; i++) {
+    if( 0 == disk_refs[( disk_hint + i ) % kernel_vmm.swap_disk_pages] )
+      break;
+  }
+  if( i == kernel_vmm.swap_disk_pages )
+    return -1;
+
+  i = ( disk_hint + i ) % kernel_vmm.swap_disk_pages;
+  vmm_fill_user_page(kernel_vmm.swap_disk_base + i,0,(char *)page_buf,PAGE_SIZE);
+  disk_refs[i] = refcount;
+  disk_hint    = i + 1;
+  kernel_vmm.swap_disk_used++;
+  return i;
+}
+
+
+/** @function  vmm_swap_read
+ *  @brief     This function reads a swapped out page into a frame
+ *  @param     handle - swap handle out of the PTE
+ *  @param     pfn    - frame to fill
+ *  @note      called with preemption disabled so the handle stays valid
+ *  @return    void
+ */
+
+void vmm_swap_read(unsigned long handle,PFN pfn) {
+  swap_zentry *zentry;
+
+  if( HANDLE_IS_DISK(handle) ) {
+    assert( disk_refs[handle] );
+    vmm_copy_user_page(pfn,kernel_vmm.swap_disk_base + handle);
+    return;
+  }
+
+  zentry = HANDLE_ZENTRY(handle);
+  assert( zentry->refcount );
+  swap_decompress(zpool + zentry->first * VMM_SWAP_ZCHUNK,zentry->len,page_buf);
+  vmm_fill_user_page(pfn,0,(char *)page_buf,PAGE_SIZE);
+}
+
+
+/** @function  vmm_swap_dup
+ *  @brief     This function takes a reference on a swapped out page for
+ *             one more PTE, e.g. when a page table is copied
+ *  @param     handle - swap handle out of the PTE
+ *  @return    void
+ */
+
+void vmm_swap_dup(unsigned long handle) {
+  uint32_t eflags;
+
+  eflags = disable_preemption();
+  if( HANDLE_IS_DISK(handle) )
+    disk_refs[handle]++;
+  else
+    HANDLE_ZENTRY(handle)->refcount++;
+  enable_preemption(eflags);
+}
+
+
+/** @function  vmm_swap_put
+ *  @brief     This function drops the reference of a PTE on a swapped
+ *             out page; the last one frees its space
+ *  @param     handle - swap handle out of the PTE
+ *  @return    void
+ */
+
+void vmm_swap_put(unsigned long handle) {
+  swap_zentry *zentry;
+  uint32_t     eflags;
+
+  eflags = disable_preemption();
+  if( HANDLE_IS_DISK(handle) ) {
+    assert( disk_refs[handle] );
+    if( 0 == --disk_refs[handle] )
+      kernel_vmm.swap_disk_used--;
+  }
+  else {
+    zentry = HANDLE_ZENTRY(handle);
+    assert( zentry->refcount );
+    if( 0 == --zentry->refcount ) {
+      memset(&zchunk_used[zentry->first],0,zentry->nr_chunks);
+      kernel_vmm.swap_zpages--;
+      kernel_vmm.swap_zbytes -= zentry->nr_chunks * VMM_SWAP_ZCHUNK;
+    }
+  }
+  enable_preemption(eflags);
+}
+
+
+/** @function  swap_out_frame
+ *  @brief     This function gives a frame a second chance if it was
+ *             touched since the last pass and evicts it otherwise
+ *  @param     pfn - frame under the clock hand
+ *  @note      called with preemption disabled
+ *  @return    1 if the frame was freed; 0 if it was passed over;
+ *             -1 if swap is full
+ */
+
+static int swap_out_frame(PFN pfn) {
+  m_page   *page = &kernel_vmm.m_pages[pfn];
+  vmm_rmap *slot;
+  PTE      *pte_page;
+  int       nr_slots = 0;
+  int       accessed = 0;
+  int       handle;
+
+  if( kernel_vmm.zero_pfn == pfn || NULL == page->rmap )
+    return 0;
+
+  //-- every reference has to be a PTE we can rewrite alone --//
+  for(slot = page->rmap; slot; slot = slot->next) {
+    if( NULL == slot->pte )
+      return 0;
+
+    pte_page = (PTE *)((unsigned long)slot->pte & ~PAGE_MASK);
+    if( 1 != kernel_vmm.m_pages[PTE_PAGE_PFN(pte_page)].refcount )
+      return 0;
+
+    accessed |= slot->pte->ACCESSED || 0 == PTE_AGE(slot->pte);
+    nr_slots++;
+  }
+  if( nr_slots != page->refcount )
+    return 0;
+
+  if( accessed ) {
+    for(slot = page->rmap; slot; slot = slot->next) {
+      slot->pte->ACCESSED = 0;
+      PTE_SET_AGE(slot->pte,1);
+      vmm_rmap_flush_slot(slot->pte);
+    }
+    return 0;
+  }
+
+  handle = swap_store(pfn,nr_slots);
+  if( handle < 0 )
+    return -1;
+
+  //-- protection bits stay; the next fault brings the page back --//
+  for(slot = page->rmap; slot; slot = slot->next) {
+    slot->pte->PRESENT = 0;
+    slot->pte->AVAIL   = PTE_AVAIL_SWAP;
+    slot->pte->ADDRESS = handle;
+    vmm_rmap_flush_slot(slot->pte);
+  }
+
+  vmm_rmap_detach(pfn);
+  while( nr_slots-- )
+    vmm_putref_user_page(pfn);
+
+  kernel_vmm.swap_outs++;
+  return 1;
+}
+
+
+/** @function  vmm_swap_reclaim
+ *  @brief     This function runs the clock hand until it has freed nr
+ *             frames, gone around twice or swap is full
+ *  @param     nr - frames wanted
+ *  @return    number of frames freed
+ */
+
+int vmm_swap_reclaim(int nr) {
+  uint32_t eflags;
+  int      scanned;
+  int      freed = 0;
+  int      ret;
+
+  eflags = disable_preemption();
+  for(scanned = 0;
+      scanned < 2 * kernel_vmm.nr_user_pages && freed < nr;
+      scanned++) {
+    ret = swap_out_frame(clock_hand);
+
+    if( ++clock_hand >= kernel_vmm.swap_disk_base )
+      clock_hand = USER_FIRST_PFN;
+
+    if( ret < 0 )
+      break;
+    freed += ret;
+  }
+
+  if( 0 == freed )
+    kernel_vmm.swap_failures++;
+  enable_preemption(eflags);
+
+  return freed;
+}
@@ -0,0 +1,182 @@
+/** @file     vmm_tlb.c
+ *  @brief    This file contains the TLB management routines of the VMM
+ *
+ *            Kernel mappings are global, so with CR4.PGE turned on they
+ *            stay in the TLB across address space switches. User
+ *            mappings are never global.
+ *
+ *            Operations that change many user PTEs collect the pages in
+ *            a tlb_batch and flush once at the end: page by page with
+ *            invlpg while the batch is small, with a single cr3 reload
+ *            once it grows past VMM_TLB_BATCH_PAGES. Nothing is flushed
+ *            for an address space that is not loaded; its entries went
+ *            away when it was switched out. Frames unmapped by the
+ *            operation are handed back only after their entries are
+ *            gone, so no stale entry ever points at a reused frame.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <cr.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  invalidate_tlb
+ *  @brief     This function invalidates the tlb using the asm INVLPG instruction
+ *  @param     addr - address whose translation changed
+ *  @return    void
+ */
+
+static inline void invalidate_tlb(unsigned long addr)
+{
+        asm volatile("invlpg (%0)" ::"r" (addr) : "memory");
+}
+
+
+/** @function  tlb_vm_is_loaded
+ *  @brief     This function checks if the VM is the one in cr3
+ */
+
+static int tlb_vm_is_loaded(struct task_vm *vm) {
+  return (uint32_t)vm->pde_base == get_cr3();
+}
+
+
+/** @function  vmm_tlb_enable_global
+ *  @brief     This function turns on global pages so the kernel
+ *             mappings survive cr3 reloads
+ *  @note      paging has to be on
+ *  @return    void
+ */
+
+void vmm_tlb_enable_global(void) {
+  set_cr4(get_cr4() | CR4_PGE);
+  kernel_vmm.tlb_global = 1;
+}
+
+
+/** @function  vmm_tlb_batch_init
+ *  @brief     This function starts collecting invalidations for a VM
+ *  @param     batch - batch to initialize
+ *  @param     vm    - VM whose mappings are being changed
+ *  @return    void
+ */
+
+void vmm_tlb_batch_init(tlb_batch *batch,struct task_vm *vm) {
+  batch->vm        = vm;
+  batch->nr_pages  = 0;
+  batch->nr_frames = 0;
+}
+
+
+/** @function  vmm_tlb_batch_add
+ *  @brief     This function queues the invalidation of one page
+ *  @param     batch   - batch being collected
+ *  @param     address - user address whose mapping changed
+ *  @param     pfn     - frame that lost its mapping and a reference;
+ *                       PFN_NULL if the frame stays mapped
+ *  @return    void
+ */
+
+void vmm_tlb_batch_add(tlb_batch *batch,unsigned long address,PFN pfn) {
+  //-- past the limit only a full flush is left to do --//
+  if( batch->nr_pages < VMM_TLB_BATCH_PAGES )
+    batch->pages[batch->nr_pages] = address;
+  if( batch->nr_pages <= VMM_TLB_BATCH_PAGES )
+    batch->nr_pages++;
+
+  if( PFN_NULL == pfn )
+    return;
+
+  batch->frames[batch->nr_frames++] = pfn;
+  if( batch->nr_frames == VMM_TLB_BATCH_PAGES )
+    vmm_tlb_batch_flush(batch);
+}
+
+
+/** @function  vmm_tlb_batch_flush
+ *  @brief     This function carries out the queued invalidations
+ *             and then releases the queued frames
+ *  @param     batch - batch being collected; empty on return
+ *  @return    void
+ */
+
+void vmm_tlb_batch_flush(tlb_batch *batch) {
+  int i;
+
+  if( 0 == batch->nr_pages )
+    return;
+
+  if( !tlb_vm_is_loaded(batch->vm) )
+    kernel_vmm.tlb_skipped++;
+  else if( batch->nr_pages > VMM_TLB_BATCH_PAGES ) {
+    set_cr3( get_cr3() );
+    kernel_vmm.tlb_full_flushes++;
+  }
+  else {
+    for(i = 0; i < batch->nr_pages; i++)
+      invalidate_tlb(batch->pages[i]);
+    kernel_vmm.tlb_invlpgs += batch->nr_pages;
+  }
+  batch->nr_pages = 0;
+
+  for(i = 0; i < batch->nr_frames; i++)
+    vmm_putref_user_page(batch->frames[i]);
+  batch->nr_frames = 0;
+}
+
+
+/** @function  vmm_tlb_flush_page
+ *  @brief     This function invalidates the mapping of one user page
+ *  @param     vm      - VM whose mapping changed
+ *  @param     address - user address whose mapping changed
+ *  @return    void
+ */
+
+void vmm_tlb_flush_page(struct task_vm *vm,unsigned long address) {
+  if( !tlb_vm_is_loaded(vm) ) {
+    kernel_vmm.tlb_skipped++;
+    return;
+  }
+
+  invalidate_tlb(address);
+  kernel_vmm.tlb_invlpgs++;
+}
+
+
+/** @function  vmm_tlb_flush_all
+ *  @brief     This function drops every user mapping of a VM from the
+ *             TLB, e.g. after a PDE changed
+ *  @param     vm - VM whose mappings changed
+ *  @return    void
+ */
+
+void vmm_tlb_flush_all(struct task_vm *vm) {
+  if( !tlb_vm_is_loaded(vm) ) {
+    kernel_vmm.tlb_skipped++;
+    return;
+  }
+
+  set_cr3( get_cr3() );
+  kernel_vmm.tlb_full_flushes++;
+}
+
+
+/** @function  vmm_tlb_count_switch
+ *  @brief     This function accounts an address space switch
+ *  @return    void
+ */
+
+void vmm_tlb_count_switch(void) {
+  kernel_vmm.tlb_switches++;
+}
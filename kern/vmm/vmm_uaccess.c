@@ -0,0 +1,148 @@
+/** @file     vmm_uaccess.c
+ *  @brief    This file contains the copies between kernel and user memory
+ *
+ *            System calls used to walk every user buffer before touching
+ *            it, checking it lies in a range and faulting its pages in.
+ *            These copies touch user memory directly instead. A page
+ *            that is not backed yet faults in kernel mode and is backed
+ *            by the page fault handler like any user fault; an address
+ *            that cannot be backed makes the handler resume the copy at
+ *            its entry in the exception table (see i386uaccess.S), and
+ *            the copy reports the failure to its caller.
+ *
+ *            Only the address check below stays on the fast path: a user
+ *            pointer must not reach into the kernel's memory, which the
+ *            kernel could write without faulting.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+#include "i386lib/i386systemregs.h"
+
+
+/** @function  uaccess_ok
+ *  @brief     This function checks that a span lies in user memory
+ *  @param     uaddr - user address
+ *  @param     len   - bytes from it
+ *  @return    1 if it does; 0 otherwise
+ */
+
+static int uaccess_ok(const void *uaddr,int len) {
+  unsigned long start = (unsigned long)uaddr;
+
+  if( len < 0 || start < USER_MEM_START )
+    return 0;
+
+  //-- no wrapping around the top of the address space --//
+  return 0 == len || start + len - 1 >= start;
+}
+
+
+/** @function  uaccess_clamp
+ *  @brief     This function clamps the bytes a string scan may look at
+ *             to the end of the address space
+ *  @param     uaddr - user address
+ *  @param     max   - bytes asked for
+ *  @return    bytes that can be looked at; a scan that finds no NUL in
+ *             them found none in max bytes either
+ */
+
+static int uaccess_clamp(const void *uaddr,int max) {
+  unsigned long left = ~0UL - (unsigned long)uaddr + 1;
+
+  if( left && left < (unsigned long)max )
+    return (int)left;
+  return max;
+}
+
+
+/** @function  vmm_copy_from_user
+ *  @brief     This function copies bytes from user memory
+ *  @param     dst  - kernel buffer
+ *  @param     usrc - user address
+ *  @param     len  - bytes to copy
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM if any of
+ *             the bytes cannot be read
+ */
+
+KERN_RET_CODE vmm_copy_from_user(void *dst,const void *usrc,int len) {
+  if( !uaccess_ok(usrc,len) )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  if( i386_copy_user(dst,usrc,len) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_copy_to_user
+ *  @brief     This function copies bytes to user memory
+ *  @param     udst - user address
+ *  @param     src  - kernel buffer
+ *  @param     len  - bytes to copy
+ *  @note      with CR0.WP set, a write to a copy on write page breaks it
+ *             just as a user write would
+ *  @return    KERN_SUCCESS on success; KERN_ERR_BAD_SYS_PARAM if any of
+ *             the bytes cannot be written; the ones before the first
+ *             bad one are written
+ */
+
+KERN_RET_CODE vmm_copy_to_user(void *udst,const void *src,int len) {
+  if( !uaccess_ok(udst,len) )
+    return KERN_ERR_BAD_SYS_PARAM;
+
+  if( i386_copy_user(udst,src,len) )
+    return KERN_ERR_BAD_SYS_PARAM;
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_strncpy_from_user
+ *  @brief     This function copies a string from user memory
+ *  @param     dst  - kernel buffer of max bytes
+ *  @param     usrc - user string
+ *  @param     max  - bytes to copy at most, the NUL included
+ *  @return    length of the string; max if its NUL is not within max
+ *             bytes; -1 if it cannot be read
+ */
+
+int vmm_strncpy_from_user(char *dst,const char *usrc,int max) {
+  int n;
+  int len;
+
+  if( !uaccess_ok(usrc,0) || max < 0 )
+    return -1;
+
+  n   = uaccess_clamp(usrc,max);
+  len = i386_strncpy_user(dst,usrc,n);
+  return ( len == n ) ? max : len;
+}
+
+
+/** @function  vmm_strnlen_user
+ *  @brief     This function measures a string in user memory
+ *  @param     usrc - user string
+ *  @param     max  - bytes to look at at most
+ *  @return    length of the string; max if its NUL is not within max
+ *             bytes; -1 if it cannot be read
+ */
+
+int vmm_strnlen_user(const char *usrc,int max) {
+  int n;
+  int len;
+
+  if( !uaccess_ok(usrc,0) || max < 0 )
+    return -1;
+
+  n   = uaccess_clamp(usrc,max);
+  len = i386_strnlen_user(usrc,n);
+  return ( len == n ) ? max : len;
+}
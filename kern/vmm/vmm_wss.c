@@ -0,0 +1,189 @@
+/** @file     vmm_wss.c
+ *  @brief    This file contains the working set sampler
+ *
+ *            Every timer tick looks at a few hundred PTEs of the running
+ *            task, picking up where the last tick left off. A page whose
+ *            accessed bit is set was touched since the last look; the
+ *            bit is cleared and the page's age, kept in the PTE's AVAIL
+ *            bits, goes back to 0. An untouched page ages by one up to
+ *            VMM_WSS_AGE_MAX. When the cursor has gone over all of user
+ *            space the counts of the pass become the task's working set
+ *            estimate and its age histogram.
+ *
+ *            The clock hand in vmm_swap.c reads the same age, so a page
+ *            the sampler found touched is not evicted just because the
+ *            sampler cleared its accessed bit first.
+ *
+ *            A tick can land in the middle of a page table edit by any
+ *            thread of the task. A page table or 4MB page is only looked
+ *            at if its reverse mapping names this task at this address.
+ *            Owners are removed before a table is freed and only change
+ *            with preemption disabled, so a stale or half written PDE
+ *            never leads the sampler into memory that is not a live page
+ *            table of this task.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+#include "i386lib/i386systemregs.h"
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  wss_owns
+ *  @brief     This function checks that a page table or 4MB page is
+ *             recorded as mapped by a VM at an address
+ *  @param     vm      - VM being sampled
+ *  @param     pfn     - frame the PDE points at
+ *  @param     address - 4MB aligned user address of the PDE
+ *  @return    1 if it is; 0 otherwise
+ */
+
+static int wss_owns(struct task_vm *vm,PFN pfn,unsigned long address) {
+  vmm_rmap *owner;
+
+  if( pfn >= (PFN)kernel_vmm.nr_physical_pages )
+    return 0;
+
+  for(owner = kernel_vmm.m_pages[pfn].rmap; owner; owner = owner->next)
+    if( NULL == owner->pte && owner->vm == vm && owner->address == address )
+      return 1;
+  return 0;
+}
+
+
+/** @function  wss_age
+ *  @brief     This function harvests the accessed bit of one mapping
+ *  @param     wss      - counts of the pass in progress
+ *  @param     entry    - PTE, or PDE of a 4MB page
+ *  @param     nr_pages - pages the entry maps
+ *  @return    1 if the accessed bit was cleared; 0 otherwise
+ */
+
+static int wss_age(vmm_wss *wss,PTE *entry,int nr_pages) {
+  int age = PTE_AGE(entry);
+  int cleared = 0;
+
+  if( entry->ACCESSED ) {
+    entry->ACCESSED = 0;
+    wss->pass.wss_pages += nr_pages;
+    age     = 0;
+    cleared = 1;
+  }
+  else if( age < VMM_WSS_AGE_MAX )
+    age++;
+
+  PTE_SET_AGE(entry,age);
+  wss->pass.resident_pages += nr_pages;
+  wss->pass.age_pages[age] += nr_pages;
+  return cleared;
+}
+
+
+/** @function  wss_end_pass
+ *  @brief     This function publishes the counts of a finished pass
+ *  @param     wss - sampler state of the task
+ *  @return    void
+ */
+
+static void wss_end_pass(vmm_wss *wss) {
+  wss->pass.passes         = wss->last.passes + 1;
+  wss->pass.wss_peak_pages = wss->last.wss_peak_pages;
+  if( wss->pass.wss_pages > wss->pass.wss_peak_pages )
+    wss->pass.wss_peak_pages = wss->pass.wss_pages;
+
+  wss->last = wss->pass;
+  memset(&wss->pass,0,sizeof(wss->pass));
+}
+
+
+/** @function  vmm_wss_tick
+ *  @brief     This function samples the next VMM_WSS_SCAN_SLOTS PTEs of
+ *             the running task
+ *  @param     vm - VM of the running task; its page directory is loaded
+ *  @note      called from the timer interrupt
+ *  @return    void
+ */
+
+void vmm_wss_tick(struct task_vm *vm) {
+  vmm_wss      *wss = &vm->wss;
+  tlb_batch     batch;
+  PDE          *pde;
+  PTE          *pte_page;
+  unsigned long base;
+  int           budget = VMM_WSS_SCAN_SLOTS;
+  int           i;
+  LINEAR_ADDRESS_BREAKER la;
+
+  if( wss->cursor < USER_MEM_START )
+    wss->cursor = USER_MEM_START;
+  wss->pass.pass_ticks++;
+  vmm_tlb_batch_init(&batch,vm);
+
+  while( budget > 0 ) {
+    la.address = wss->cursor;
+    pde  = &vm->pde_base[la.u.PDE_IDX];
+    base = wss->cursor & ~LARGE_PAGE_MASK;
+    budget--;
+
+    if( PDE_IS_LARGE(pde) ) {
+      if( wss_owns(vm,pde->ADDRESS,base) && wss_age(wss,pde,PTE_PER_PAGE) )
+	vmm_tlb_batch_add(&batch,base,PFN_NULL);
+    }
+    else if( pde->PRESENT && wss_owns(vm,pde->ADDRESS,base) ) {
+      pte_page = PDE_PTE_PAGE(pde);
+      for(i = la.u.PTE_IDX; i < PTE_PER_PAGE && budget > 0; i++, budget--) {
+	if( PTE_IS_SWAPPED(&pte_page[i]) )
+	  wss->pass.swapped_pages++;
+	else if( pte_page[i].PRESENT &&
+		 kernel_vmm.zero_pfn != pte_page[i].ADDRESS &&
+		 wss_age(wss,&pte_page[i],1) )
+	  vmm_tlb_batch_add(&batch,base + i * PAGE_SIZE,PFN_NULL);
+      }
+
+      //-- out of budget inside this table; resume at the next slot --//
+      if( i < PTE_PER_PAGE ) {
+	wss->cursor = base + i * PAGE_SIZE;
+	break;
+      }
+    }
+
+    //-- past the last 4MB the cursor wraps to 0 --//
+    wss->cursor = base + LARGE_PAGE_SIZE;
+    if( 0 == wss->cursor ) {
+      wss_end_pass(wss);
+      break;
+    }
+  }
+
+  vmm_tlb_batch_flush(&batch);
+}
+
+
+/** @function  vmm_wss_get_stats
+ *  @brief     This function reports the last finished pass over a VM
+ *  @param     vm    - VM of the task asked about
+ *  @param     stats - placeholder for the statistics
+ *  @return    void
+ */
+
+void vmm_wss_get_stats(struct task_vm *vm,wss_stats_t *stats) {
+  wss_stats_t last;
+  uint32_t    eflags;
+
+  //-- the timer replaces it under us otherwise --//
+  eflags = disable_preemption();
+  last = vm->wss.last;
+  enable_preemption(eflags);
+
+  memcpy(stats,&last,sizeof(last));
+}
@@ -0,0 +1,121 @@
+/** @file     vmm_zeropool.c
+ *  @brief    This file contains the pool of pre-zeroed user frames
+ *
+ *            The idle thread clears free frames ahead of time and parks
+ *            them on a small pool threaded through m_page.next. Fault
+ *            handling and the loader ask for zeroed frames through
+ *            vmm_get_zeroed_user_page() and only clear a frame on the
+ *            faulting thread's path when the pool is empty.
+ *
+ *            Pool frames hold their allocation reference, so they are
+ *            not counted as free. Refill stops while free memory is low
+ *            and the pool is handed back to the buddy allocator when an
+ *            allocation would otherwise fail.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#include <console.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <simics.h>
+#include <kern_common.h>
+
+
+extern kern_vmm kernel_vmm;
+
+
+/** @function  vmm_get_zeroed_user_page
+ *  @brief     This function is used to get a user frame filled with zeroes
+ *  @param     pfn - pointer to frame number holder
+ *  @return    KERN_SUCCESS on successful get; else KERN_NO_MEM
+ */
+
+KERN_RET_CODE vmm_get_zeroed_user_page(PFN *pfn) {
+  KERN_RET_CODE ret;
+  uint32_t      eflags;
+
+  eflags = disable_preemption();
+  if( PFN_NULL != kernel_vmm.zero_pool_head ) {
+    *pfn = kernel_vmm.zero_pool_head;
+    kernel_vmm.zero_pool_head = kernel_vmm.m_pages[*pfn].next;
+    kernel_vmm.m_pages[*pfn].next = PFN_NULL;
+    kernel_vmm.zero_pool_nr--;
+    kernel_vmm.zero_pool_hits++;
+    enable_preemption(eflags);
+    return KERN_SUCCESS;
+  }
+  kernel_vmm.zero_pool_misses++;
+  enable_preemption(eflags);
+
+  ret = vmm_get_free_user_pages(pfn);
+  if( KERN_SUCCESS != ret )
+    return ret;
+
+  vmm_zero_user_page(*pfn);
+  return KERN_SUCCESS;
+}
+
+
+/** @function  vmm_zero_pool_refill
+ *  @brief     This function clears free frames into the pool; meant to
+ *             run from the idle thread
+ *  @param     budget - most frames to clear in this call
+ *  @return    number of frames added to the pool
+ */
+
+int vmm_zero_pool_refill(int budget) {
+  uint32_t eflags;
+  PFN      pfn;
+  int      added = 0;
+
+  while( added < budget ) {
+    //-- leave the last free frames to real allocations --//
+    if( kernel_vmm.zero_pool_nr >= VMM_ZERO_POOL_PAGES ||
+	vmm_nr_free_user_pages() <= VMM_ZERO_POOL_LOW )
+      break;
+
+    if( KERN_SUCCESS != vmm_alloc_user_pages(0,&pfn) )
+      break;
+
+    vmm_zero_user_page(pfn);
+
+    eflags = disable_preemption();
+    kernel_vmm.m_pages[pfn].next = kernel_vmm.zero_pool_head;
+    kernel_vmm.zero_pool_head    = pfn;
+    kernel_vmm.zero_pool_nr++;
+    enable_preemption(eflags);
+    added++;
+  }
+
+  return added;
+}
+
+
+/** @function  vmm_zero_pool_reclaim
+ *  @brief     This function gives every pooled frame back to the
+ *             buddy allocator
+ *  @return    number of frames released
+ */
+
+int vmm_zero_pool_reclaim(void) {
+  uint32_t eflags;
+  PFN      pfn;
+  int      released = 0;
+
+  eflags = disable_preemption();
+  while( PFN_NULL != kernel_vmm.zero_pool_head ) {
+    pfn = kernel_vmm.zero_pool_head;
+    kernel_vmm.zero_pool_head = kernel_vmm.m_pages[pfn].next;
+    kernel_vmm.m_pages[pfn].next = PFN_NULL;
+    kernel_vmm.zero_pool_nr--;
+    vmm_putref_user_page(pfn);
+    released++;
+  }
+  enable_preemption(eflags);
+
+  return released;
+}
@@ -0,0 +1,21 @@
+/** @file     madvise.h
+ *  @brief    This file defines the advice taken by the madvise() system
+ *            call. It is shared between the kernel and user land.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#ifndef _MADVISE_H
+#define _MADVISE_H
+
+//-- fault-around is kept per range; these apply to the whole range --//
+#define MADV_NORMAL      0     //- default fault-around window          -//
+#define MADV_RANDOM      1     //- one page per fault                   -//
+#define MADV_SEQUENTIAL  2     //- wide fault-around window             -//
+
+//-- these apply to the pages given --//
+#define MADV_WILLNEED    3     //- back the pages now                   -//
+#define MADV_DONTNEED    4     //- give the frames back; the pages read -//
+                               //- as zero, or as loaded, on next touch -//
+
+#endif // _MADVISE_H
@@ -0,0 +1,95 @@
+/** @file     memstats.h
+ *  @brief    This file defines the memory statistics block that is
+ *            filled in by the memstats() system call. It is shared
+ *            between the kernel and user land.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#ifndef _MEMSTATS_H
+#define _MEMSTATS_H
+
+//-- orders 0..10 i.e. blocks from 4K to 4MB --//
+#define MEMSTATS_NR_ORDERS 11
+
+typedef struct memstats {
+  int nr_physical_frames;      //- all frames in the machine          -//
+  int nr_user_frames;          //- frames managed by the frame pool   -//
+  int nr_free_frames;          //- frames currently free              -//
+  int largest_free_order;      //- -1 when the pool is exhausted      -//
+
+  //-- free blocks available at each order --//
+  int free_blocks[MEMSTATS_NR_ORDERS];
+
+  //-- unusable free space index per order in percent                --//
+  //-- 0: all free memory can satisfy an allocation of this order    --//
+  //-- 100: none of the free memory can satisfy it                   --//
+  int unusable_index[MEMSTATS_NR_ORDERS];
+
+  //-- zero page --//
+  int zero_page_faults;        //- read faults mapped to the zero page -//
+  int zero_page_breaks;        //- first writes that got a real frame  -//
+  int zero_page_mapped;        //- frames saved right now              -//
+
+  //-- pre-zeroed frame pool --//
+  int zero_pool_frames;        //- zeroed frames waiting in the pool   -//
+  int zero_pool_hits;          //- zeroed frames taken from the pool   -//
+  int zero_pool_misses;        //- zeroed frames cleared on demand     -//
+
+  //-- fault-around --//
+  int fault_around_faults;     //- faults that mapped extra pages      -//
+  int fault_around_pages;      //- extra pages mapped by those faults  -//
+
+  //-- memory hints --//
+  int madvise_prefaulted;      //- pages backed ahead of use           -//
+  int madvise_dropped;         //- pages whose frames were given back  -//
+
+  //-- copy on write --//
+  int cow_copies;              //- shared frames copied on write       -//
+  int cow_promotions;          //- sole owner frames made writable     -//
+
+  //-- demand paged executables --//
+  int file_page_fills;         //- frames filled from a program image  -//
+  int image_cache_frames;      //- read only frames shared by programs -//
+  int image_cache_hits;        //- faults served by a shared frame     -//
+  int image_cache_misses;      //- faults that filled a frame to share -//
+  int image_cache_evictions;   //- shared frames freed under pressure  -//
+
+  //-- reverse mappings --//
+  int rmap_entries;            //- frame mappings tracked right now    -//
+
+  //-- swap --//
+  int swap_disk_slots;         //- pages the RAM disk can hold         -//
+  int swap_disk_used;          //- pages on the RAM disk               -//
+  int swap_compressed_pages;   //- pages held compressed in memory     -//
+  int swap_compressed_bytes;   //- memory those pages take up          -//
+  int swap_outs;               //- frames evicted under pressure       -//
+  int swap_ins;                //- evicted pages faulted back in       -//
+  int swap_failures;           //- reclaims that freed nothing         -//
+
+  //-- same page merging --//
+  int ksm_sweeps;              //- idle scans over all user frames     -//
+  int ksm_merged_frames;       //- frames freed into identical frames  -//
+  int ksm_zero_frames;         //- frames of zeroes given back         -//
+
+  //-- shared memory segments --//
+  int shm_segments;            //- segments alive                     -//
+  int shm_frames;              //- frames held by them                 -//
+  int shm_maps;                //- faults that mapped a segment frame  -//
+
+  //-- kernel object caches --//
+  int cache_objects_active;    //- objects handed out right now       -//
+  int cache_objects_free;      //- objects waiting on free lists       -//
+  int cache_hits;              //- allocations served by a free list   -//
+  int cache_grows;             //- slabs carved from kernel memory     -//
+  int kstacks_reaped;          //- stacks freed after their thread died -//
+
+  //-- TLB --//
+  int tlb_global;              //- kernel entries are global (PGE)     -//
+  int tlb_invlpgs;             //- single page invalidations           -//
+  int tlb_full_flushes;        //- full flushes of an address space    -//
+  int tlb_skipped;             //- flushes skipped; space not loaded   -//
+  int tlb_switches;            //- address space switches              -//
+}memstats_t;
+
+#endif // _MEMSTATS_H
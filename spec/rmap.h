@@ -0,0 +1,21 @@
+/** @file     rmap.h
+ *  @brief    This file defines the frame mapping records filled in by
+ *            the frame_mappings() system call. It is shared between
+ *            the kernel and user land.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#ifndef _RMAP_H
+#define _RMAP_H
+
+//-- most records one frame_mappings() call fills in --//
+#define RMAP_QUERY_MAX 256
+
+typedef struct rmap_mapping {
+  int          tid;            //- initial thread of the mapping task  -//
+  unsigned int address;        //- user address the frame is mapped at -//
+  int          writable;       //- 1 if a write would not fault        -//
+}rmap_mapping_t;
+
+#endif // _RMAP_H
@@ -16,6 +16,7 @@
 /* Life cycle */
 int fork(void);
 int exec(char *execname, char *argvec[]);
+int spawn(char *execname, char *argvec[]);
 void set_status(int status);
 void vanish(void) NORETURN;
 int wait(int *status_ptr);
@@ -31,6 +32,16 @@ int sleep(int ticks);
 /* Memory management */
 int new_pages(void * addr, int len);
 int remove_pages(void * addr);
+int madvise(void *addr, int len, int advice);
+int shm_create(void *addr, int len);
+int shm_attach(int shmid, void *addr);
+int shm_detach(void *addr);
+struct memstats;
+int memstats(struct memstats *stats);
+struct rmap_mapping;
+int frame_mappings(int pfn, struct rmap_mapping *buf, int count);
+struct wss_stats;
+int wss_stats(int tid, struct wss_stats *stats);
 
 /* Console I/O */
 char getchar(void);
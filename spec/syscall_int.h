@@ -63,4 +63,14 @@
 #define SYSCALL_RESERVED_15       0x8F
 #define SYSCALL_RESERVED_END      0x8F
 
+/* Kernel extensions living in the reserved range */
+#define MEMSTATS_INT              SYSCALL_RESERVED_0
+#define SPAWN_INT                 SYSCALL_RESERVED_1
+#define FRAME_MAPPINGS_INT        SYSCALL_RESERVED_2
+#define WSS_STATS_INT             SYSCALL_RESERVED_3
+#define MADVISE_INT               SYSCALL_RESERVED_4
+#define SHM_CREATE_INT            SYSCALL_RESERVED_5
+#define SHM_ATTACH_INT            SYSCALL_RESERVED_6
+#define SHM_DETACH_INT            SYSCALL_RESERVED_7
+
 #endif /* _SYSCALL_INT_H */
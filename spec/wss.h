@@ -0,0 +1,26 @@
+/** @file     wss.h
+ *  @brief    This file defines the working set statistics filled in by
+ *            the wss_stats() system call. It is shared between the
+ *            kernel and user land.
+ *
+ *  @author   Faraz Shaikh (fshaikh) Deepak Amin (dvamin)
+ */
+
+#ifndef _WSS_H
+#define _WSS_H
+
+//-- resident pages are binned by passes since they were last touched --//
+//-- bin 0 is hot; the last bin holds everything idle for longer      --//
+#define WSS_AGE_BINS 4
+
+typedef struct wss_stats {
+  int passes;                  //- full scans of the address space    -//
+  int pass_ticks;              //- ticks the task ran during the last -//
+  int wss_pages;               //- pages touched during the last pass -//
+  int wss_peak_pages;          //- largest wss_pages seen so far      -//
+  int resident_pages;          //- pages backed by a frame            -//
+  int swapped_pages;           //- pages swapped out                  -//
+  int age_pages[WSS_AGE_BINS]; //- resident pages by age              -//
+}wss_stats_t;
+
+#endif // _WSS_H
@@ -0,0 +1,20 @@
+/**@file sc_lc_spawn.c
+ * @brief stub for  system call - spawn
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+
+#define THIS_SYSCALL_INT         SPAWN_INT
+#define THIS_SYSCALL_PARAMS_NR   2
+#define THIS_SYSCALL_STR         "spawn"
+#include "sc_asm_template.h"
+
+int spawn(char *execname, char *argvec[]) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;  
+}
@@ -0,0 +1,23 @@
+/**@file sc_misc_frame_mappings.c
+ * @brief stub for  system call - frame_mappings
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+#include <syscall.h>
+#include <rmap.h>
+#include <stdlib.h>
+
+#define THIS_SYSCALL_INT         FRAME_MAPPINGS_INT
+#define THIS_SYSCALL_PARAMS_NR   3
+#define THIS_SYSCALL_STR         "frame_mappings"
+#include "sc_asm_template.h"
+
+int frame_mappings(int pfn, struct rmap_mapping *buf, int count) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;
+}
@@ -0,0 +1,23 @@
+/**@file sc_misc_memstats.c
+ * @brief stub for  system call - memstats
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+#include <syscall.h>
+#include <memstats.h>
+#include <stdlib.h>
+
+#define THIS_SYSCALL_INT         MEMSTATS_INT
+#define THIS_SYSCALL_PARAMS_NR   1
+#define THIS_SYSCALL_STR         "memstats"
+#include "sc_asm_template.h"
+
+int memstats(struct memstats *stats) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;
+}
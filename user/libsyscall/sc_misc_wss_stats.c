@@ -0,0 +1,23 @@
+/**@file sc_misc_wss_stats.c
+ * @brief stub for  system call - wss_stats
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+#include <syscall.h>
+#include <wss.h>
+#include <stdlib.h>
+
+#define THIS_SYSCALL_INT         WSS_STATS_INT
+#define THIS_SYSCALL_PARAMS_NR   2
+#define THIS_SYSCALL_STR         "wss_stats"
+#include "sc_asm_template.h"
+
+int wss_stats(int tid, struct wss_stats *stats) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;
+}
@@ -0,0 +1,22 @@
+/**@file sc_mm_madvise.c
+ * @brief stub for  system call - madvise
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+#include <syscall.h>
+#include <stdlib.h>
+
+#define THIS_SYSCALL_INT         MADVISE_INT
+#define THIS_SYSCALL_PARAMS_NR   3
+#define THIS_SYSCALL_STR         "madvise"
+#include "sc_asm_template.h"
+
+int madvise(void * addr, int len, int advice) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;
+}
@@ -0,0 +1,22 @@
+/**@file sc_mm_shm_attach.c
+ * @brief stub for  system call - shm_attach
+ *
+ * @author Deepak Amin (dvamin), Faraz Shaikh (fshaikh)
+ *
+ * @bug None known
+ */
+
+#include <syscall_int.h>
+#include <syscall.h>
+#include <stdlib.h>
+
+#define THIS_SYSCALL_INT         SHM_ATTACH_INT
+#define THIS_SYSCALL_PARAMS_NR   2
+#define THIS_SYSCALL_STR         "shm_attach"
+#include "sc_asm_template.h"
+
+int shm_attach(int shmid, void * addr) {
+  int __result;
+  trap_str(THIS_SYSCALL_INT,THIS_SYSCALL_PARAMS_NR);
+  return __result;
+}